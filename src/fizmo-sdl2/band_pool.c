@@ -0,0 +1,249 @@
+/* band_pool.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/unused.h>
+
+#include "band_pool.h"
+
+#define MAX_NUMBER_OF_BAND_POOL_THREADS 16
+
+struct band_job {
+  band_function function;
+  void *data;
+  int nof_rows;
+  int nof_bands;
+  SDL_atomic_t next_band;
+  SDL_atomic_t nof_bands_done;
+};
+
+static int number_of_band_pool_threads = BAND_POOL_AUTO_THREADS;
+static SDL_Thread *band_pool_threads[MAX_NUMBER_OF_BAND_POOL_THREADS];
+static int number_of_running_threads = 0;
+
+// "band_pool_mutex" protects the fields below it. "band_job_mutex" makes
+// sure only one job is run at a time.
+static SDL_mutex *band_pool_mutex = NULL;
+static SDL_cond *band_pool_work_cond = NULL;
+static SDL_cond *band_pool_done_cond = NULL;
+static struct band_job *current_job = NULL;
+static unsigned int current_job_generation = 0;
+static int nof_threads_in_job = 0;
+static bool band_pool_should_stop = false;
+static SDL_mutex *band_job_mutex = NULL;
+
+
+static void process_bands(struct band_job *job) {
+  int band;
+
+  while ((band = SDL_AtomicAdd(&job->next_band, 1)) < job->nof_bands) {
+    job->function(
+        (int)((long)band * job->nof_rows / job->nof_bands),
+        (int)((long)(band + 1) * job->nof_rows / job->nof_bands),
+        band,
+        job->data);
+    SDL_AtomicAdd(&job->nof_bands_done, 1);
+  }
+}
+
+
+static int band_pool_thread_function(void *UNUSED(data)) {
+  unsigned int last_generation = 0;
+  struct band_job *job;
+
+  SDL_LockMutex(band_pool_mutex);
+
+  for (;;) {
+    while ( (band_pool_should_stop == false)
+        && ( (current_job == NULL)
+          || (current_job_generation == last_generation) ) )
+      SDL_CondWait(band_pool_work_cond, band_pool_mutex);
+
+    if (band_pool_should_stop == true)
+      break;
+
+    last_generation = current_job_generation;
+    job = current_job;
+    nof_threads_in_job++;
+    SDL_UnlockMutex(band_pool_mutex);
+
+    process_bands(job);
+
+    SDL_LockMutex(band_pool_mutex);
+    // The job lives on the submitter's stack, so it may only return once
+    // no thread is looking at it anymore.
+    nof_threads_in_job--;
+    SDL_CondSignal(band_pool_done_cond);
+  }
+
+  SDL_UnlockMutex(band_pool_mutex);
+
+  return 0;
+}
+
+
+void set_number_of_band_pool_threads(int nof_threads) {
+  number_of_band_pool_threads
+    = nof_threads < 0 ? BAND_POOL_AUTO_THREADS : nof_threads;
+}
+
+
+int get_number_of_band_pool_threads() {
+  return number_of_band_pool_threads;
+}
+
+
+void start_band_pool() {
+  char thread_name[32];
+  int nof_threads, i;
+
+  if (number_of_running_threads > 0)
+    return;
+
+  if ((nof_threads = number_of_band_pool_threads) == BAND_POOL_AUTO_THREADS)
+    nof_threads = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+  if (nof_threads > MAX_NUMBER_OF_BAND_POOL_THREADS)
+    nof_threads = MAX_NUMBER_OF_BAND_POOL_THREADS;
+  if (nof_threads < 1)
+    return;
+
+  band_pool_mutex = SDL_CreateMutex();
+  band_pool_work_cond = SDL_CreateCond();
+  band_pool_done_cond = SDL_CreateCond();
+  band_job_mutex = SDL_CreateMutex();
+  band_pool_should_stop = false;
+
+  for (i=0; i<nof_threads; i++) {
+    snprintf(thread_name, sizeof(thread_name), "BandPoolThread%d", i);
+    if ((band_pool_threads[i] = SDL_CreateThread(
+            band_pool_thread_function, thread_name, NULL)) == NULL)
+      break;
+    number_of_running_threads++;
+  }
+
+  TRACE_LOG("Started %d band pool threads.\n", number_of_running_threads);
+}
+
+
+void stop_band_pool() {
+  int i;
+
+  if (band_pool_mutex == NULL)
+    return;
+
+  SDL_LockMutex(band_pool_mutex);
+  band_pool_should_stop = true;
+  SDL_CondBroadcast(band_pool_work_cond);
+  SDL_UnlockMutex(band_pool_mutex);
+
+  for (i=0; i<number_of_running_threads; i++)
+    SDL_WaitThread(band_pool_threads[i], NULL);
+  number_of_running_threads = 0;
+
+  SDL_DestroyMutex(band_job_mutex);
+  SDL_DestroyCond(band_pool_done_cond);
+  SDL_DestroyCond(band_pool_work_cond);
+  SDL_DestroyMutex(band_pool_mutex);
+  band_job_mutex = NULL;
+  band_pool_mutex = NULL;
+}
+
+
+void detach_band_pool() {
+  number_of_running_threads = 0;
+  band_pool_mutex = NULL;
+}
+
+
+int plan_bands(int nof_rows, size_t bytes_per_row, int min_band_height) {
+  int nof_bands;
+
+  if ( (number_of_running_threads == 0)
+      || ((size_t)nof_rows * bytes_per_row < BAND_POOL_MIN_PARALLEL_BYTES) )
+    return 1;
+
+  if (min_band_height < BAND_POOL_MIN_BAND_HEIGHT)
+    min_band_height = BAND_POOL_MIN_BAND_HEIGHT;
+
+  // A few more bands than threads keep all of them busy in case some
+  // bands take longer than others.
+  nof_bands = (number_of_running_threads + 1) * 4;
+  if (nof_bands > nof_rows / min_band_height)
+    nof_bands = nof_rows / min_band_height;
+
+  return nof_bands < 1 ? 1 : nof_bands;
+}
+
+
+void run_in_bands(int nof_rows, int nof_bands, band_function function,
+    void *data) {
+  struct band_job job;
+
+  if ( (nof_bands <= 1) || (number_of_running_threads == 0) ) {
+    function(0, nof_rows, 0, data);
+    return;
+  }
+
+  job.function = function;
+  job.data = data;
+  job.nof_rows = nof_rows;
+  job.nof_bands = nof_bands;
+  SDL_AtomicSet(&job.next_band, 0);
+  SDL_AtomicSet(&job.nof_bands_done, 0);
+
+  SDL_LockMutex(band_job_mutex);
+
+  SDL_LockMutex(band_pool_mutex);
+  current_job = &job;
+  current_job_generation++;
+  SDL_CondBroadcast(band_pool_work_cond);
+  SDL_UnlockMutex(band_pool_mutex);
+
+  process_bands(&job);
+
+  SDL_LockMutex(band_pool_mutex);
+  while ( (SDL_AtomicGet(&job.nof_bands_done) < nof_bands)
+      || (nof_threads_in_job > 0) )
+    SDL_CondWait(band_pool_done_cond, band_pool_mutex);
+  current_job = NULL;
+  SDL_UnlockMutex(band_pool_mutex);
+
+  SDL_UnlockMutex(band_job_mutex);
+}
+
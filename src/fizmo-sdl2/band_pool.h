@@ -0,0 +1,83 @@
+/* band_pool.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A small persistent thread pool which runs large framebuffer operations
+ * in horizontal bands. Idle threads -- including the calling one --
+ * claim the next unprocessed band until none are left, so that uneven
+ * bands don't leave threads waiting. Operations below a size threshold
+ * are run serially by the caller.
+ *
+ */
+
+
+#ifndef band_pool_h_INCLUDED
+#define band_pool_h_INCLUDED
+
+#include <stddef.h>
+
+#include <tools/types.h>
+
+// Operations touching fewer bytes are not split up.
+#define BAND_POOL_MIN_PARALLEL_BYTES (1024 * 1024)
+#define BAND_POOL_MIN_BAND_HEIGHT 16
+
+// Processes rows "first_row" up to, but not including, "end_row".
+typedef void (*band_function)(int first_row, int end_row, int band_index,
+    void *data);
+
+// BAND_POOL_AUTO_THREADS, the default, picks one thread less than there
+// are cores, zero runs everything serially.
+#define BAND_POOL_AUTO_THREADS -1
+
+void set_number_of_band_pool_threads(int nof_threads);
+int get_number_of_band_pool_threads();
+
+void start_band_pool();
+void stop_band_pool();
+
+// To be called in a forked child, which doesn't inherit the pool's
+// threads. All operations are run serially from then on.
+void detach_band_pool();
+
+// Returns the number of bands an operation on "nof_rows" rows should be
+// split into, with each band at least "min_band_height" rows high.
+int plan_bands(int nof_rows, size_t bytes_per_row, int min_band_height);
+
+// Runs "function" for all bands and returns once all are processed.
+// Band "i" covers rows i*nof_rows/nof_bands to (i+1)*nof_rows/nof_bands.
+void run_in_bands(int nof_rows, int nof_bands, band_function function,
+    void *data);
+
+#endif // band_pool_h_INCLUDED
+
@@ -0,0 +1,365 @@
+/* batch_runner.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <tools/i18n.h>
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <interpreter/streams.h>
+
+#include "batch_runner.h"
+#include "../locales/fizmo_sdl2_locales.h"
+
+#define BATCH_MANIFEST_LINE_BUF_SIZE 4096
+
+struct batch_worker {
+  pid_t pid;
+  int result_fd;
+  size_t job_index;
+  struct timeval start_time;
+};
+
+struct batch_job_report {
+  bool finished;
+  bool failed;
+  // Only meaningful in case "failed" is false.
+  bool completed;
+  int exit_status;
+  long turns;
+  long frames;
+  double elapsed_seconds;
+  long peak_rss_kb;
+};
+
+static int result_pipe_fd = -1;
+
+
+int get_default_number_of_batch_workers() {
+  long nof_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return nof_cores < 1 ? 1 : (int)nof_cores;
+}
+
+
+static char *dup_manifest_field(char *field) {
+  if ( (field == NULL) || (strcmp(field, "-") == 0) )
+    return NULL;
+  return strdup(field);
+}
+
+
+static batch_job *load_batch_manifest(char *manifest_filename,
+    size_t *nof_jobs) {
+  FILE *manifest;
+  char line[BATCH_MANIFEST_LINE_BUF_SIZE];
+  char *story, *blorb, *script, *saveptr;
+  batch_job *jobs = NULL;
+  size_t jobs_size = 0;
+  int line_number = 0;
+
+  *nof_jobs = 0;
+
+  if ((manifest = fopen(manifest_filename, "r")) == NULL) {
+    i18n_translate(
+        fizmo_sdl2_module_name,
+        i18n_sdl2_COULD_NOT_OPEN_OR_FIND_P0S,
+        manifest_filename);
+    streams_latin1_output("\n");
+    exit(EXIT_FAILURE);
+  }
+
+  while (fgets(line, BATCH_MANIFEST_LINE_BUF_SIZE, manifest) != NULL) {
+    line_number++;
+
+    if ((story = strtok_r(line, " \t\r\n", &saveptr)) == NULL)
+      continue;
+    if (*story == '#')
+      continue;
+    blorb = strtok_r(NULL, " \t\r\n", &saveptr);
+    script = blorb != NULL ? strtok_r(NULL, " \t\r\n", &saveptr) : NULL;
+
+    if ( (strcmp(story, "-") == 0)
+        || ( (script != NULL)
+          && (strtok_r(NULL, " \t\r\n", &saveptr) != NULL) ) ) {
+      i18n_translate(
+          fizmo_sdl2_module_name,
+          i18n_sdl2_INVALID_LINE_P0D_IN_BATCH_MANIFEST_P1S,
+          line_number,
+          manifest_filename);
+      streams_latin1_output("\n");
+      exit(EXIT_FAILURE);
+    }
+
+    if (*nof_jobs == jobs_size) {
+      jobs_size += 64;
+      jobs = fizmo_realloc(jobs, sizeof(batch_job) * jobs_size);
+    }
+
+    jobs[*nof_jobs].story_filename = strdup(story);
+    jobs[*nof_jobs].blorb_filename = dup_manifest_field(blorb);
+    jobs[*nof_jobs].script_filename = dup_manifest_field(script);
+    (*nof_jobs)++;
+  }
+
+  fclose(manifest);
+
+  return jobs;
+}
+
+
+static double get_elapsed_seconds(struct timeval *start) {
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec)
+    + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+
+static void collect_batch_worker(struct batch_worker *worker,
+    struct batch_job_report *report, int status, struct rusage *usage) {
+  batch_job_result result;
+  ssize_t bytes_read;
+
+  report->finished = true;
+  report->elapsed_seconds = get_elapsed_seconds(&worker->start_time);
+
+#ifdef __APPLE__
+  report->peak_rss_kb = usage->ru_maxrss / 1024;
+#else
+  report->peak_rss_kb = usage->ru_maxrss;
+#endif // __APPLE__
+
+  report->exit_status
+    = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+  do {
+    bytes_read = read(worker->result_fd, &result, sizeof(batch_job_result));
+  }
+  while ( (bytes_read == -1) && (errno == EINTR) );
+
+  if (bytes_read == sizeof(batch_job_result)) {
+    report->failed = report->exit_status != 0;
+    report->completed = result.completed;
+    report->turns = result.turns;
+    report->frames = result.frames;
+  }
+  else {
+    report->failed = true;
+    report->completed = false;
+    report->turns = 0;
+    report->frames = 0;
+  }
+
+  close(worker->result_fd);
+  worker->pid = 0;
+}
+
+
+static void print_batch_summary(batch_job *jobs, size_t nof_jobs,
+    struct batch_job_report *reports, double total_seconds) {
+  size_t i, nof_completed = 0, nof_exhausted = 0;
+  long total_turns = 0, total_frames = 0, max_rss_kb = 0;
+  char *status;
+
+  printf("\n%5s  %-9s %9s %7s %10s %8s %12s  %s\n",
+      "job", "status", "time(s)", "turns", "turns/s", "frames",
+      "rss(KiB)", "story");
+
+  for (i=0; i<nof_jobs; i++) {
+    if (reports[i].failed == true)
+      status = "failed";
+    else if (reports[i].completed == true) {
+      status = "completed";
+      nof_completed++;
+    }
+    else {
+      status = "exhausted";
+      nof_exhausted++;
+    }
+    total_turns += reports[i].turns;
+    total_frames += reports[i].frames;
+    if (reports[i].peak_rss_kb > max_rss_kb)
+      max_rss_kb = reports[i].peak_rss_kb;
+
+    printf("%5zu  %-9s %9.3f %7ld %10.1f %8ld %12ld  %s\n",
+        i + 1,
+        status,
+        reports[i].elapsed_seconds,
+        reports[i].turns,
+        reports[i].elapsed_seconds > 0
+        ? reports[i].turns / reports[i].elapsed_seconds
+        : 0.0,
+        reports[i].frames,
+        reports[i].peak_rss_kb,
+        jobs[i].story_filename);
+  }
+
+  printf("\n%zu jobs, %zu completed, %zu ran out of input, %zu failed "
+      "in %.3f s, %ld turns (%.1f turns/s), %ld frames, max. rss %ld KiB.\n",
+      nof_jobs, nof_completed, nof_exhausted,
+      nof_jobs - nof_completed - nof_exhausted, total_seconds,
+      total_turns,
+      total_seconds > 0 ? total_turns / total_seconds : 0.0,
+      total_frames,
+      max_rss_kb);
+}
+
+
+batch_job *run_batch_jobs(char *manifest_filename, int number_of_workers) {
+  batch_job *jobs;
+  size_t nof_jobs, next_job = 0, nof_failed = 0;
+  struct batch_worker *workers;
+  struct batch_job_report *reports;
+  struct timeval batch_start_time;
+  struct rusage usage;
+  int nof_running = 0, status, pipe_fds[2], i, j;
+  pid_t pid;
+
+  jobs = load_batch_manifest(manifest_filename, &nof_jobs);
+
+  if (number_of_workers < 1)
+    number_of_workers = get_default_number_of_batch_workers();
+
+  workers = fizmo_malloc(sizeof(struct batch_worker) * number_of_workers);
+  memset(workers, 0, sizeof(struct batch_worker) * number_of_workers);
+  reports = fizmo_malloc(sizeof(struct batch_job_report) * (nof_jobs + 1));
+  memset(reports, 0, sizeof(struct batch_job_report) * (nof_jobs + 1));
+
+  TRACE_LOG("Running %zu batch jobs with %d workers.\n",
+      nof_jobs, number_of_workers);
+
+  gettimeofday(&batch_start_time, NULL);
+
+  while ( (next_job < nof_jobs) || (nof_running > 0) ) {
+
+    // Start new workers until either all slots are busy or there are
+    // no more jobs left.
+    for (i=0; (i<number_of_workers) && (next_job < nof_jobs); i++) {
+      if (workers[i].pid != 0)
+        continue;
+
+      if (pipe(pipe_fds) != 0) {
+        i18n_translate_and_exit(
+            fizmo_sdl2_module_name,
+            i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+            -1,
+            "pipe");
+      }
+
+      fflush(stdout);
+      fflush(stderr);
+
+      if ((pid = fork()) == -1) {
+        i18n_translate_and_exit(
+            fizmo_sdl2_module_name,
+            i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+            -1,
+            "fork");
+      }
+      else if (pid == 0) {
+        // Worker process: Drop all file descriptors belonging to the
+        // other workers and return the job to run.
+        for (j=0; j<number_of_workers; j++)
+          if (workers[j].pid != 0)
+            close(workers[j].result_fd);
+        close(pipe_fds[0]);
+        result_pipe_fd = pipe_fds[1];
+        return &jobs[next_job];
+      }
+
+      close(pipe_fds[1]);
+      workers[i].pid = pid;
+      workers[i].result_fd = pipe_fds[0];
+      workers[i].job_index = next_job;
+      gettimeofday(&workers[i].start_time, NULL);
+      TRACE_LOG("Started worker %d for job %zu.\n", pid, next_job);
+      next_job++;
+      nof_running++;
+    }
+
+    if ((pid = wait4(-1, &status, 0, &usage)) == -1) {
+      if (errno == EINTR)
+        continue;
+      i18n_translate_and_exit(
+          fizmo_sdl2_module_name,
+          i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+          -1,
+          "wait4");
+    }
+
+    for (i=0; i<number_of_workers; i++) {
+      if (workers[i].pid == pid) {
+        TRACE_LOG("Worker %d for job %zu finished.\n",
+            pid, workers[i].job_index);
+        collect_batch_worker(
+            &workers[i], &reports[workers[i].job_index], status, &usage);
+        if (reports[workers[i].job_index].failed == true)
+          nof_failed++;
+        nof_running--;
+        break;
+      }
+    }
+  }
+
+  print_batch_summary(
+      jobs, nof_jobs, reports, get_elapsed_seconds(&batch_start_time));
+
+  exit(nof_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+void report_batch_job_result(batch_job_result *result) {
+  ssize_t bytes_written;
+
+  if (result_pipe_fd == -1)
+    return;
+
+  do {
+    bytes_written = write(
+        result_pipe_fd, result, sizeof(batch_job_result));
+  }
+  while ( (bytes_written == -1) && (errno == EINTR) );
+
+  close(result_pipe_fd);
+  result_pipe_fd = -1;
+}
+
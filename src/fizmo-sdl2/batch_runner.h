@@ -0,0 +1,83 @@
+/* batch_runner.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ * Since libfizmo keeps its state in global variables, a single process
+ * can only ever run one story. The batch runner works around this by
+ * forking one worker process per job listed in a manifest file. The
+ * parent never initializes SDL or starts a story itself, it only
+ * distributes the jobs, collects the results sent back through a pipe
+ * and prints a summary once all workers have finished.
+ *
+ * Every non-empty line of the manifest which doesn't start with a '#'
+ * describes one job and consists of up to three whitespace-separated
+ * fields: the story filename, the blorb filename and the filename of a
+ * command script. A "-" may be used as a placeholder for a field that
+ * should remain unset.
+ *
+ */
+
+
+#ifndef batch_runner_h_INCLUDED
+#define batch_runner_h_INCLUDED
+
+#include <tools/types.h>
+
+struct batch_job {
+  char *story_filename;
+  char *blorb_filename;
+  char *script_filename;
+};
+typedef struct batch_job batch_job;
+
+struct batch_job_result {
+  // True in case the story ended on its own, false in case the session
+  // was ended because the command script ran out while the story was
+  // still waiting for input.
+  bool completed;
+  long turns;
+  long frames;
+};
+typedef struct batch_job_result batch_job_result;
+
+int get_default_number_of_batch_workers();
+
+// This function returns only in the forked worker processes, each time
+// with the job the worker is supposed to run. The parent process exits
+// after all jobs have been processed and the summary has been printed.
+batch_job *run_batch_jobs(char *manifest_filename, int number_of_workers);
+
+// To be called by a worker process once its story session has ended.
+void report_batch_job_result(batch_job_result *result);
+
+#endif // batch_runner_h_INCLUDED
+
@@ -0,0 +1,253 @@
+/* blorb_index.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/filesys.h>
+
+#include "blorb_index.h"
+#include "mmap_filesys.h"
+
+struct blorb_source {
+  z_file *in;
+  uint8_t *mapped_data;
+  size_t size;
+};
+
+static blorb_index_entry *index_entries = NULL;
+static uint32_t nof_index_entries = 0;
+static bool index_loaded = false;
+static bool index_load_attempted = false;
+static char *index_filename = NULL;
+static SDL_mutex *index_mutex = NULL;
+
+
+static uint32_t read_uint32(uint8_t *data) {
+  return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+    | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+
+static bool read_blorb_bytes(struct blorb_source *src, size_t offset,
+    void *dest, size_t len) {
+  if ( (offset > src->size) || (len > src->size - offset) )
+    return false;
+
+  if (src->mapped_data != NULL) {
+    memcpy(dest, src->mapped_data + offset, len);
+    return true;
+  }
+
+  if (fsi->setfilepos(src->in, offset, SEEK_SET) != 0)
+    return false;
+
+  return fsi->readchars(dest, len, src->in) == len;
+}
+
+
+// Reads the "RIdx" chunk, which blorb files are required to have as the
+// first chunk, and returns its contents without the chunk header.
+static uint8_t *read_ridx_chunk(struct blorb_source *src, uint32_t *len) {
+  uint8_t header[20];
+  uint8_t *ridx;
+
+  if ( (read_blorb_bytes(src, 0, header, 20) == false)
+      || (memcmp(header, "FORM", 4) != 0)
+      || (memcmp(header + 8, "IFRS", 4) != 0)
+      || (memcmp(header + 12, "RIdx", 4) != 0) ) {
+    return NULL;
+  }
+
+  *len = read_uint32(header + 16);
+  if ( (*len < 4) || (*len > src->size - 20) )
+    return NULL;
+
+  ridx = fizmo_malloc(*len);
+  if (read_blorb_bytes(src, 20, ridx, *len) == false) {
+    free(ridx);
+    return NULL;
+  }
+
+  return ridx;
+}
+
+
+static int compare_index_entries(const void *a, const void *b) {
+  const blorb_index_entry *entry_a = a, *entry_b = b;
+
+  if (entry_a->usage != entry_b->usage)
+    return entry_a->usage < entry_b->usage ? -1 : 1;
+  if (entry_a->number != entry_b->number)
+    return entry_a->number < entry_b->number ? -1 : 1;
+  return 0;
+}
+
+
+static bool scan_blorb_file(struct blorb_source *src, uint8_t *ridx,
+    uint32_t ridx_len) {
+  uint32_t nof_resources, i;
+  uint8_t chunk_header[12];
+  blorb_index_entry *entry;
+  size_t pos;
+
+  nof_resources = read_uint32(ridx);
+  if (nof_resources > (ridx_len - 4) / 12)
+    return false;
+
+  index_entries = fizmo_malloc(
+      sizeof(blorb_index_entry) * (nof_resources + 1));
+  nof_index_entries = 0;
+
+  for (i=0; i<nof_resources; i++) {
+    entry = &index_entries[nof_index_entries];
+    entry->usage = read_uint32(ridx + 4 + i*12);
+    entry->number = read_uint32(ridx + 8 + i*12);
+    // The resource index points to the chunk header.
+    pos = read_uint32(ridx + 12 + i*12);
+
+    if (read_blorb_bytes(src, pos, chunk_header, 8) == false) {
+      TRACE_LOG("Invalid offset %zu for resource %d.\n", pos, entry->number);
+      continue;
+    }
+
+    entry->chunk_type = read_uint32(chunk_header);
+    entry->offset = pos + 8;
+    entry->length = read_uint32(chunk_header + 4);
+
+    nof_index_entries++;
+  }
+
+  // Entries are kept sorted, so that lookups are a binary search.
+  qsort(index_entries, nof_index_entries, sizeof(blorb_index_entry),
+      &compare_index_entries);
+
+  return true;
+}
+
+
+static bool load_blorb_index(char *blorb_filename) {
+  struct blorb_source src;
+  uint8_t *ridx;
+  uint32_t ridx_len;
+  long size;
+
+  if ((src.in = fsi->openfile(blorb_filename, FILETYPE_DATA, FILEACCESS_READ))
+      == NULL)
+    return false;
+
+  if ( (fsi->setfilepos(src.in, 0, SEEK_END) != 0)
+      || ((size = fsi->getfilepos(src.in)) < 0) ) {
+    fsi->closefile(src.in);
+    return false;
+  }
+  src.size = size;
+  src.mapped_data = get_mapped_file_data(src.in, &src.size);
+
+  if ((ridx = read_ridx_chunk(&src, &ridx_len)) == NULL) {
+    fsi->closefile(src.in);
+    return false;
+  }
+
+  if (scan_blorb_file(&src, ridx, ridx_len) == true) {
+    TRACE_LOG("Indexed blorb file, %d resources.\n", nof_index_entries);
+    index_loaded = true;
+  }
+
+  free(ridx);
+  fsi->closefile(src.in);
+
+  return index_loaded;
+}
+
+
+void set_blorb_index_file(char *blorb_filename) {
+  if ( (index_filename != NULL)
+      && (strcmp(index_filename, blorb_filename) == 0) )
+    return;
+
+  free_blorb_index();
+
+  if (index_mutex == NULL)
+    index_mutex = SDL_CreateMutex();
+
+  index_filename = strdup(blorb_filename);
+}
+
+
+void free_blorb_index() {
+  free(index_entries);
+  index_entries = NULL;
+  nof_index_entries = 0;
+  index_loaded = false;
+  index_load_attempted = false;
+  free(index_filename);
+  index_filename = NULL;
+}
+
+
+blorb_index_entry *get_blorb_index_entry(uint32_t usage, int number) {
+  blorb_index_entry key;
+
+  if ( (index_filename == NULL) || (number < 0) )
+    return NULL;
+
+  // The index is built on the first lookup, which may happen on any
+  // thread. Once loaded, the entries are never modified.
+  SDL_LockMutex(index_mutex);
+  if (index_load_attempted == false) {
+    index_load_attempted = true;
+    index_loaded = load_blorb_index(index_filename);
+  }
+  SDL_UnlockMutex(index_mutex);
+
+  if (index_loaded == false)
+    return NULL;
+
+  key.usage = usage;
+  key.number = number;
+
+  return bsearch(&key, index_entries, nof_index_entries,
+      sizeof(blorb_index_entry), &compare_index_entries);
+}
+
+
+char *get_blorb_index_filename() {
+  return index_loaded == true ? index_filename : NULL;
+}
+
@@ -0,0 +1,83 @@
+/* blorb_index.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A frontend-side index of a blorb file's resources, so that pictures
+ * and sounds may be read using file handles of their own instead of the
+ * story's blorb stream. Building the index requires reading every
+ * resource's chunk header, which is cheap for memory-mapped files and
+ * is done on the first resource lookup.
+ *
+ */
+
+
+#ifndef blorb_index_h_INCLUDED
+#define blorb_index_h_INCLUDED
+
+#include <tools/types.h>
+
+#define BLORB_INDEX_ID(a, b, c, d) \
+  ( ((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) \
+    | ((uint32_t)(c) << 8) | (uint32_t)(d) )
+
+#define BLORB_INDEX_USAGE_PICTURE BLORB_INDEX_ID('P', 'i', 'c', 't')
+#define BLORB_INDEX_USAGE_SOUND BLORB_INDEX_ID('S', 'n', 'd', ' ')
+#define BLORB_INDEX_USAGE_EXEC BLORB_INDEX_ID('E', 'x', 'e', 'c')
+
+typedef struct {
+  uint32_t usage;
+  uint32_t number;
+  // Offset of the chunk's data, which follows the 8-byte chunk header.
+  uint32_t offset;
+  uint32_t length;
+  // IFF chunk type like "PNG ", "JPEG", "AIFF" or "OGGV".
+  uint32_t chunk_type;
+} blorb_index_entry;
+
+// Sets the blorb file to index. The index is built on the first call to
+// get_blorb_index_entry(). Setting the same file again keeps an index
+// which is already loaded.
+void set_blorb_index_file(char *blorb_filename);
+void free_blorb_index();
+
+// Returns NULL in case the resource doesn't exist or the file is not a
+// valid blorb file.
+blorb_index_entry *get_blorb_index_entry(uint32_t usage, int number);
+
+// Returns the name of the indexed blorb file, so that its resources may
+// be read using a file handle of one's own, or NULL in case no index
+// could be loaded.
+char *get_blorb_index_filename();
+
+#endif // blorb_index_h_INCLUDED
+
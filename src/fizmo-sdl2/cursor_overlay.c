@@ -0,0 +1,267 @@
+/* cursor_overlay.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <interpreter/fizmo.h>
+
+#include "cursor_overlay.h"
+
+struct cursor_state {
+  SDL_Rect position;
+  bool is_placed;
+  bool is_visible;
+  bool is_waiting_for_input;
+  // Set whenever the cursor is moved or shown, restarting the blink
+  // cycle.
+  bool was_changed;
+};
+
+// Z-machine standard 8.3.7 true colours, starting at Z_COLOUR_BLACK.
+static uint8_t z_colour_rgb[][3] = {
+  { 0x00, 0x00, 0x00 },
+  { 0xe8, 0x00, 0x00 },
+  { 0x00, 0xd0, 0x00 },
+  { 0xe8, 0xe8, 0x00 },
+  { 0x00, 0x68, 0xb0 },
+  { 0xf8, 0x00, 0xf8 },
+  { 0x00, 0xe8, 0xe8 },
+  { 0xf8, 0xf8, 0xf8 }
+};
+
+static bool cursor_overlay_enabled = false;
+static int cursor_blink_interval = DEFAULT_CURSOR_BLINK_INTERVAL;
+static SDL_Renderer *cursor_renderer = NULL;
+static uint8_t cursor_rgb[3];
+
+// Written by the interpreter thread, read by the main thread.
+static SDL_mutex *cursor_state_mutex = NULL;
+static struct cursor_state cursor_state;
+
+// Owned by the interpreter thread.
+int last_text_pixel_x = -1;
+int last_text_pixel_y = -1;
+static SDL_Rect last_cursor_fill = { -1, -1, 0, 0 };
+
+// Owned by the main thread.
+static struct cursor_state presented_state;
+static bool blink_phase_is_on = true;
+static Uint32 blink_phase_start = 0;
+
+
+void set_cursor_overlay_enabled(bool enabled) {
+  cursor_overlay_enabled = enabled;
+}
+
+
+bool is_cursor_overlay_enabled() {
+  return cursor_overlay_enabled;
+}
+
+
+void set_cursor_blink_interval(int interval) {
+  cursor_blink_interval = interval;
+}
+
+
+int get_cursor_blink_interval() {
+  return cursor_blink_interval;
+}
+
+
+void init_cursor_overlay(SDL_Renderer *renderer, z_colour cursor_colour) {
+  if ( (cursor_overlay_enabled == false)
+      || (renderer == NULL)
+      || (cursor_colour < Z_COLOUR_BLACK)
+      || (cursor_colour > Z_COLOUR_WHITE) )
+    return;
+
+  cursor_rgb[0] = z_colour_rgb[cursor_colour - Z_COLOUR_BLACK][0];
+  cursor_rgb[1] = z_colour_rgb[cursor_colour - Z_COLOUR_BLACK][1];
+  cursor_rgb[2] = z_colour_rgb[cursor_colour - Z_COLOUR_BLACK][2];
+
+  cursor_state.is_placed = false;
+  cursor_state.is_visible = true;
+  cursor_state.is_waiting_for_input = false;
+  cursor_state.was_changed = false;
+  presented_state = cursor_state;
+
+  cursor_state_mutex = SDL_CreateMutex();
+  cursor_renderer = renderer;
+}
+
+
+void free_cursor_overlay() {
+  if (cursor_state_mutex != NULL) {
+    SDL_DestroyMutex(cursor_state_mutex);
+    cursor_state_mutex = NULL;
+  }
+  cursor_renderer = NULL;
+}
+
+
+bool is_cursor_fill(int x, int y, int width, int height,
+    uint8_t r, uint8_t g, uint8_t b) {
+  if ( (cursor_renderer == NULL)
+      || (r != cursor_rgb[0])
+      || (g != cursor_rgb[1])
+      || (b != cursor_rgb[2])
+      || (width <= 0)
+      || (width > CURSOR_MAX_WIDTH)
+      || (width * 2 > height) )
+    return false;
+
+  // After a deletion the cursor moves left on its line, otherwise it
+  // directly follows the text, allowing for a space in between.
+  if ( ( (y != last_cursor_fill.y) || (height != last_cursor_fill.h) )
+      && ( (last_text_pixel_y < y)
+        || (last_text_pixel_y >= y + height)
+        || (last_text_pixel_x >= x)
+        || (x - last_text_pixel_x > height) ) )
+    return false;
+
+  last_cursor_fill.x = x;
+  last_cursor_fill.y = y;
+  last_cursor_fill.w = width;
+  last_cursor_fill.h = height;
+
+  SDL_LockMutex(cursor_state_mutex);
+  cursor_state.position.x = x;
+  cursor_state.position.y = y;
+  cursor_state.position.w = width;
+  cursor_state.position.h = height;
+  cursor_state.is_placed = true;
+  cursor_state.was_changed = true;
+  SDL_UnlockMutex(cursor_state_mutex);
+
+  return true;
+}
+
+
+void cursor_area_overwritten(int x, int y, int width, int height) {
+  // The position is only written by this thread, so it may be read
+  // without locking.
+  if ( (cursor_renderer == NULL)
+      || (cursor_state.is_placed == false)
+      || (x >= cursor_state.position.x + cursor_state.position.w)
+      || (x + width <= cursor_state.position.x)
+      || (y >= cursor_state.position.y + cursor_state.position.h)
+      || (y + height <= cursor_state.position.y) )
+    return;
+
+  SDL_LockMutex(cursor_state_mutex);
+  cursor_state.is_placed = false;
+  cursor_state.was_changed = true;
+  SDL_UnlockMutex(cursor_state_mutex);
+}
+
+
+void set_cursor_overlay_waiting_for_input(bool waiting) {
+  if (cursor_renderer == NULL)
+    return;
+
+  SDL_LockMutex(cursor_state_mutex);
+  cursor_state.is_waiting_for_input = waiting;
+  cursor_state.was_changed = true;
+  SDL_UnlockMutex(cursor_state_mutex);
+}
+
+
+void set_cursor_overlay_visibility(bool visible) {
+  if (cursor_renderer == NULL)
+    return;
+
+  SDL_LockMutex(cursor_state_mutex);
+  if (cursor_state.is_visible != visible) {
+    cursor_state.is_visible = visible;
+    cursor_state.was_changed = true;
+  }
+  SDL_UnlockMutex(cursor_state_mutex);
+}
+
+
+bool update_cursor_overlay(Uint32 ticks) {
+  bool was_changed;
+
+  if (cursor_renderer == NULL)
+    return false;
+
+  SDL_LockMutex(cursor_state_mutex);
+  was_changed = cursor_state.was_changed;
+  cursor_state.was_changed = false;
+  presented_state = cursor_state;
+  SDL_UnlockMutex(cursor_state_mutex);
+
+  if (was_changed == true) {
+    blink_phase_is_on = true;
+    blink_phase_start = ticks;
+    return true;
+  }
+
+  if ( (cursor_blink_interval == 0)
+      || (presented_state.is_placed == false)
+      || (presented_state.is_visible == false)
+      || (presented_state.is_waiting_for_input == false)
+      || (ticks - blink_phase_start < (Uint32)cursor_blink_interval) )
+    return false;
+
+  blink_phase_is_on = !blink_phase_is_on;
+  blink_phase_start = ticks;
+  return true;
+}
+
+
+void render_cursor_overlay(float x_scale, float y_scale) {
+  SDL_FRect rect;
+
+  if ( (cursor_renderer == NULL)
+      || (presented_state.is_placed == false)
+      || (presented_state.is_visible == false)
+      || (presented_state.is_waiting_for_input == false)
+      || (blink_phase_is_on == false) )
+    return;
+
+  rect.x = presented_state.position.x * x_scale;
+  rect.y = presented_state.position.y * y_scale;
+  rect.w = presented_state.position.w * x_scale;
+  rect.h = presented_state.position.h * y_scale;
+
+  SDL_SetRenderDrawColor(cursor_renderer,
+      cursor_rgb[0], cursor_rgb[1], cursor_rgb[2], 0xff);
+  SDL_RenderFillRectF(cursor_renderer, &rect);
+}
+
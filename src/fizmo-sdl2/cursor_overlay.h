@@ -0,0 +1,96 @@
+/* cursor_overlay.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Draws the input cursor at presentation time instead of into the
+ * framebuffer, so that moving the cursor or blinking it neither modifies
+ * the framebuffer nor causes any uploads.
+ *
+ * libpixelif draws its cursor itself, as a narrow fill in the cursor
+ * colour. Such fills are intercepted and only move the overlay, provided
+ * they're at the text position: right behind the most recently drawn
+ * text pixel, or on the line the cursor was last placed on. The
+ * cursor colour is taken from the "cursor-color" setting, falling back to
+ * the foreground colour. The overlay is removed once something else is
+ * drawn over it, and it's only shown while the interpreter is waiting
+ * for input.
+ *
+ */
+
+
+#ifndef cursor_overlay_h_INCLUDED
+#define cursor_overlay_h_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#define DEFAULT_CURSOR_BLINK_INTERVAL 530
+// Wider fills are never taken for the cursor.
+#define CURSOR_MAX_WIDTH 2
+
+void set_cursor_overlay_enabled(bool enabled);
+bool is_cursor_overlay_enabled();
+// In milliseconds, 0 disables blinking.
+void set_cursor_blink_interval(int interval);
+int get_cursor_blink_interval();
+
+void init_cursor_overlay(SDL_Renderer *renderer, z_colour cursor_colour);
+void free_cursor_overlay();
+
+// Invoked by the interpreter thread. Returns true in case the fill is
+// the cursor, which then isn't to be drawn into the framebuffer.
+bool is_cursor_fill(int x, int y, int width, int height,
+    uint8_t r, uint8_t g, uint8_t b);
+void cursor_area_overwritten(int x, int y, int width, int height);
+
+// The text pixel case is inlined since it's run for every pixel
+// libpixelif draws.
+extern int last_text_pixel_x;
+extern int last_text_pixel_y;
+
+static inline void cursor_text_pixel_drawn(int x, int y) {
+  last_text_pixel_x = x;
+  last_text_pixel_y = y;
+}
+
+void set_cursor_overlay_visibility(bool visible);
+void set_cursor_overlay_waiting_for_input(bool waiting);
+
+// Invoked by the main thread. Returns true when the cursor's appearance
+// has changed since the last frame was presented.
+bool update_cursor_overlay(Uint32 ticks);
+void render_cursor_overlay(float x_scale, float y_scale);
+
+#endif // cursor_overlay_h_INCLUDED
+
@@ -0,0 +1,263 @@
+/* damage_tracker.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+
+#include "damage_tracker.h"
+
+uint8_t *damaged_tiles = NULL;
+int damage_tiles_per_row = 0;
+
+static int damage_tile_rows = 0;
+static int framebuffer_width = 0;
+static int framebuffer_height = 0;
+static SDL_Rect *damaged_rects = NULL;
+// Indexes into "damaged_rects" of the rectangles ending in the previous
+// and in the current tile row.
+static int *previous_row_rects = NULL;
+static int *current_row_rects = NULL;
+
+
+void init_damage_tracker(int width, int height) {
+  free_damage_tracker();
+
+  framebuffer_width = width;
+  framebuffer_height = height;
+  damage_tiles_per_row = (width + DAMAGE_TILE_SIZE - 1) >> DAMAGE_TILE_SHIFT;
+  damage_tile_rows = (height + DAMAGE_TILE_SIZE - 1) >> DAMAGE_TILE_SHIFT;
+
+  damaged_tiles = fizmo_malloc(damage_tiles_per_row * damage_tile_rows);
+  // At most every other tile in a row starts a new run.
+  damaged_rects = fizmo_malloc(
+      sizeof(SDL_Rect) * damage_tile_rows * (damage_tiles_per_row / 2 + 1));
+  previous_row_rects
+    = fizmo_malloc(sizeof(int) * (damage_tiles_per_row / 2 + 1));
+  current_row_rects
+    = fizmo_malloc(sizeof(int) * (damage_tiles_per_row / 2 + 1));
+
+  mark_everything_damaged();
+}
+
+
+void free_damage_tracker() {
+  free(damaged_tiles);
+  free(damaged_rects);
+  free(previous_row_rects);
+  free(current_row_rects);
+  damaged_tiles = NULL;
+  damaged_rects = NULL;
+  previous_row_rects = NULL;
+  current_row_rects = NULL;
+}
+
+
+void mark_damaged_area(int x, int y, int width, int height) {
+  int first_column, end_column, row, end_row;
+
+  if (x < 0) {
+    width += x;
+    x = 0;
+  }
+  if (y < 0) {
+    height += y;
+    y = 0;
+  }
+  if (x + width > framebuffer_width)
+    width = framebuffer_width - x;
+  if (y + height > framebuffer_height)
+    height = framebuffer_height - y;
+  if ( (width <= 0) || (height <= 0) )
+    return;
+
+  first_column = x >> DAMAGE_TILE_SHIFT;
+  end_column = ((x + width - 1) >> DAMAGE_TILE_SHIFT) + 1;
+  end_row = ((y + height - 1) >> DAMAGE_TILE_SHIFT) + 1;
+
+  for (row = y >> DAMAGE_TILE_SHIFT; row < end_row; row++)
+    memset(damaged_tiles + row * damage_tiles_per_row + first_column,
+        1, end_column - first_column);
+}
+
+
+void scroll_damage(int x, int y, int width, int height, int distance) {
+  int first_column, end_column, row, column, dest_top, dest_bottom;
+  int first_src_row, end_src_row, src_row;
+  uint8_t *dest_tiles;
+
+  if ( (width <= 0) || (distance <= 0) || (distance >= height) )
+    return;
+
+  first_column = x >> DAMAGE_TILE_SHIFT;
+  end_column = ((x + width - 1) >> DAMAGE_TILE_SHIFT) + 1;
+
+  // Going top-down, every tile row only reads rows below itself, which
+  // haven't been modified yet.
+  for (row = y >> DAMAGE_TILE_SHIFT;
+      (row << DAMAGE_TILE_SHIFT) < y + height - distance;
+      row++) {
+    dest_top = row << DAMAGE_TILE_SHIFT;
+    if (dest_top < y)
+      dest_top = y;
+    dest_bottom = (row + 1) << DAMAGE_TILE_SHIFT;
+    if (dest_bottom > y + height - distance)
+      dest_bottom = y + height - distance;
+
+    first_src_row = (dest_top + distance) >> DAMAGE_TILE_SHIFT;
+    end_src_row = ((dest_bottom + distance - 1) >> DAMAGE_TILE_SHIFT) + 1;
+    dest_tiles = damaged_tiles + row * damage_tiles_per_row;
+
+    for (src_row=first_src_row; src_row<end_src_row; src_row++)
+      for (column=first_column; column<end_column; column++)
+        dest_tiles[column]
+          |= damaged_tiles[src_row * damage_tiles_per_row + column];
+  }
+}
+
+
+void mark_everything_damaged() {
+  memset(damaged_tiles, 1, damage_tiles_per_row * damage_tile_rows);
+}
+
+
+int collect_damaged_rects(SDL_Rect **rects) {
+  int nof_rects = 0, nof_previous = 0, nof_current, row, column;
+  int run_start, i, *swap;
+  uint8_t *tiles;
+  SDL_Rect *rect;
+
+  for (row=0; row<damage_tile_rows; row++) {
+    tiles = damaged_tiles + row * damage_tiles_per_row;
+    nof_current = 0;
+    column = 0;
+
+    while (column < damage_tiles_per_row) {
+      if (tiles[column] == 0) {
+        column++;
+        continue;
+      }
+
+      run_start = column;
+      while ( (column < damage_tiles_per_row) && (tiles[column] != 0) )
+        column++;
+
+      // A run spanning the same columns as one in the row above extends
+      // that rectangle downwards.
+      rect = NULL;
+      for (i=0; i<nof_previous; i++) {
+        if ( (damaged_rects[previous_row_rects[i]].x
+              == run_start << DAMAGE_TILE_SHIFT)
+            && (damaged_rects[previous_row_rects[i]].w
+              == (column - run_start) << DAMAGE_TILE_SHIFT) ) {
+          rect = &damaged_rects[previous_row_rects[i]];
+          rect->h += DAMAGE_TILE_SIZE;
+          current_row_rects[nof_current++] = previous_row_rects[i];
+          break;
+        }
+      }
+
+      if (rect == NULL) {
+        rect = &damaged_rects[nof_rects];
+        rect->x = run_start << DAMAGE_TILE_SHIFT;
+        rect->y = row << DAMAGE_TILE_SHIFT;
+        rect->w = (column - run_start) << DAMAGE_TILE_SHIFT;
+        rect->h = DAMAGE_TILE_SIZE;
+        current_row_rects[nof_current++] = nof_rects++;
+      }
+    }
+
+    swap = previous_row_rects;
+    previous_row_rects = current_row_rects;
+    current_row_rects = swap;
+    nof_previous = nof_current;
+  }
+
+  // Tiles at the right and bottom edges may extend beyond the
+  // framebuffer.
+  for (i=0; i<nof_rects; i++) {
+    if (damaged_rects[i].x + damaged_rects[i].w > framebuffer_width)
+      damaged_rects[i].w = framebuffer_width - damaged_rects[i].x;
+    if (damaged_rects[i].y + damaged_rects[i].h > framebuffer_height)
+      damaged_rects[i].h = framebuffer_height - damaged_rects[i].y;
+  }
+
+  memset(damaged_tiles, 0, damage_tiles_per_row * damage_tile_rows);
+
+  *rects = damaged_rects;
+  return nof_rects;
+}
+
+
+int collect_damaged_row_spans(SDL_Rect **rects) {
+  int nof_rects = 0, row;
+  bool row_is_damaged;
+  SDL_Rect *rect = NULL;
+
+  for (row=0; row<damage_tile_rows; row++) {
+    row_is_damaged
+      = memchr(damaged_tiles + row * damage_tiles_per_row, 1,
+          damage_tiles_per_row) != NULL;
+
+    if (row_is_damaged == false) {
+      rect = NULL;
+    }
+    else if (rect != NULL) {
+      rect->h += DAMAGE_TILE_SIZE;
+    }
+    else {
+      rect = &damaged_rects[nof_rects++];
+      rect->x = 0;
+      rect->y = row << DAMAGE_TILE_SHIFT;
+      rect->w = framebuffer_width;
+      rect->h = DAMAGE_TILE_SIZE;
+    }
+  }
+
+  if ( (nof_rects > 0)
+      && (damaged_rects[nof_rects - 1].y + damaged_rects[nof_rects - 1].h
+        > framebuffer_height) ) {
+    damaged_rects[nof_rects - 1].h
+      = framebuffer_height - damaged_rects[nof_rects - 1].y;
+  }
+
+  memset(damaged_tiles, 0, damage_tiles_per_row * damage_tile_rows);
+
+  *rects = damaged_rects;
+  return nof_rects;
+}
+
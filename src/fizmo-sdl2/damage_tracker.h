@@ -0,0 +1,85 @@
+/* damage_tracker.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Keeps track of which parts of the framebuffer have been modified since
+ * the last frame was presented, so that only these have to be copied to
+ * the window surface or uploaded to the texture. The framebuffer is
+ * divided into square tiles, marking a pixel marks its whole tile.
+ *
+ */
+
+
+#ifndef damage_tracker_h_INCLUDED
+#define damage_tracker_h_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#define DAMAGE_TILE_SHIFT 5
+#define DAMAGE_TILE_SIZE (1 << DAMAGE_TILE_SHIFT)
+
+// Sets up tracking for a framebuffer of the given size, which starts out
+// completely damaged.
+void init_damage_tracker(int width, int height);
+void free_damage_tracker();
+
+void mark_damaged_area(int x, int y, int width, int height);
+void mark_everything_damaged();
+
+// Moves the damage inside the given area up by "distance" rows, for the
+// case its contents have been scrolled without being marked as damaged.
+// The damage which was there before is kept.
+void scroll_damage(int x, int y, int width, int height, int distance);
+
+// The pixel case is inlined since it's run for every pixel libpixelif
+// draws.
+extern uint8_t *damaged_tiles;
+extern int damage_tiles_per_row;
+
+static inline void mark_damaged_pixel(int x, int y) {
+  damaged_tiles[(y >> DAMAGE_TILE_SHIFT) * damage_tiles_per_row
+    + (x >> DAMAGE_TILE_SHIFT)] = 1;
+}
+
+// Returns the damaged area as a list of rectangles in "rects" and resets
+// the damage. The list stays valid until the next call.
+int collect_damaged_rects(SDL_Rect **rects);
+
+// Like collect_damaged_rects, but returns full-width row spans, which
+// suits texture uploads better than many narrow rectangles.
+int collect_damaged_row_spans(SDL_Rect **rects);
+
+#endif // damage_tracker_h_INCLUDED
+
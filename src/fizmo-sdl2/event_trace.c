@@ -0,0 +1,305 @@
+/* event_trace.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/unused.h>
+
+#include "event_trace.h"
+#include "profile_output.h"
+
+#define EVENT_TRACE_RING_MASK (EVENT_TRACE_RING_SIZE - 1)
+
+struct trace_event {
+  uint64_t timestamp;
+  uint32_t arg;
+  uint16_t id;
+  uint8_t phase;
+};
+
+// Every ring is only written by its own thread. Rings are never freed,
+// since their events may still be written out after the thread has ended.
+struct trace_ring {
+  struct trace_event events[EVENT_TRACE_RING_SIZE];
+  SDL_atomic_t write_count;
+  SDL_threadID thread_id;
+  char *thread_name;
+  struct trace_ring *next;
+};
+
+struct trace_event_type {
+  char *name;
+  char *category;
+};
+
+static struct trace_event_type trace_event_types[NUMBER_OF_TRACE_EVENTS] = {
+  { "get_next_event", "input" },
+  { "push_sdl_event", "input" },
+  { "update_screen", "render" },
+  { "do_update_screen", "render" },
+  { "upload_rows", "render" },
+  { "present_frame", "render" },
+  { "resize1", "resize" },
+  { "resize2", "resize" },
+  { "event_queue_length", "input" },
+  { "wait sdl_main_thread_working_mutex", "lock" },
+  { "wait sdl_backup_surface_mutex", "lock" },
+  { "wait sdl_event_queue_mutex", "lock" },
+  { "wait resize_event_pending_mutex", "lock" },
+  { "wait timeout_semaphore", "lock" },
+  { "wait update_screen_wait_cond", "lock" },
+  { "wait sdl_main_thread_working_cond", "lock" },
+  { "wait interpreter_finished_processing_winch_cond", "lock" }
+};
+
+bool event_tracing_enabled = false;
+
+static char *event_trace_filename = NULL;
+static SDL_TLSID trace_ring_tls = 0;
+static SDL_mutex *trace_ring_list_mutex = NULL;
+static struct trace_ring *trace_rings = NULL;
+static Uint64 trace_start_counter;
+static volatile sig_atomic_t event_trace_signal_received = 0;
+
+
+void set_event_trace_filename(char *filename) {
+  free(event_trace_filename);
+  event_trace_filename = filename != NULL ? strdup(filename) : NULL;
+}
+
+
+char *get_event_trace_filename() {
+  return event_trace_filename;
+}
+
+
+static void event_trace_signal_handler(int UNUSED(signal_number)) {
+  event_trace_signal_received = 1;
+}
+
+
+void start_event_trace() {
+  if ( (event_trace_filename == NULL) || (event_tracing_enabled == true) )
+    return;
+
+  if (trace_ring_tls == 0) {
+    trace_ring_tls = SDL_TLSCreate();
+    trace_ring_list_mutex = SDL_CreateMutex();
+  }
+
+  trace_start_counter = SDL_GetPerformanceCounter();
+  signal(SIGUSR1, &event_trace_signal_handler);
+  event_tracing_enabled = true;
+
+  TRACE_LOG("Event tracing to \"%s\".\n", event_trace_filename);
+}
+
+
+void disable_event_trace() {
+  event_tracing_enabled = false;
+}
+
+
+static struct trace_ring *get_trace_ring() {
+  struct trace_ring *ring;
+
+  if ((ring = SDL_TLSGet(trace_ring_tls)) != NULL)
+    return ring;
+
+  ring = fizmo_malloc(sizeof(struct trace_ring));
+  SDL_AtomicSet(&ring->write_count, 0);
+  ring->thread_id = SDL_ThreadID();
+  ring->thread_name = NULL;
+
+  SDL_LockMutex(trace_ring_list_mutex);
+  ring->next = trace_rings;
+  trace_rings = ring;
+  SDL_UnlockMutex(trace_ring_list_mutex);
+
+  SDL_TLSSet(trace_ring_tls, ring, NULL);
+
+  return ring;
+}
+
+
+void set_event_trace_thread_name(char *name) {
+  struct trace_ring *ring;
+
+  if (event_tracing_enabled == false)
+    return;
+
+  ring = get_trace_ring();
+  free(ring->thread_name);
+  ring->thread_name = strdup(name);
+}
+
+
+void record_trace_event(enum trace_event_id id, char phase, uint32_t arg) {
+  struct trace_ring *ring = get_trace_ring();
+  uint32_t index = (uint32_t)SDL_AtomicGet(&ring->write_count);
+  struct trace_event *event = &ring->events[index & EVENT_TRACE_RING_MASK];
+
+  event->timestamp = SDL_GetPerformanceCounter();
+  event->arg = arg;
+  event->id = id;
+  event->phase = phase;
+
+  // Publishes the event to the exporter, SDL_AtomicSet is a full barrier.
+  SDL_AtomicSet(&ring->write_count, (int)(index + 1));
+}
+
+
+static void write_trace_event(FILE *out, struct trace_event *event,
+    int pid, SDL_threadID thread_id, double ticks_per_us) {
+  struct trace_event_type *type = &trace_event_types[event->id];
+
+  fprintf(out,
+      ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+      "\"pid\":%d,\"tid\":%lu",
+      type->name,
+      type->category,
+      event->phase,
+      (double)(event->timestamp - trace_start_counter) / ticks_per_us,
+      pid,
+      (unsigned long)thread_id);
+
+  if (event->phase == TRACE_PHASE_COUNTER)
+    fprintf(out, ",\"args\":{\"value\":%" PRIu32 "}}", event->arg);
+  else if (event->phase == TRACE_PHASE_INSTANT)
+    fprintf(out, ",\"s\":\"t\",\"args\":{\"value\":%" PRIu32 "}}",
+        event->arg);
+  else if (event->arg != 0)
+    fprintf(out, ",\"args\":{\"value\":%" PRIu32 "}}", event->arg);
+  else
+    fputs("}", out);
+}
+
+
+// Copies the ring's events while its thread may keep on writing, and
+// then drops all copied events which may have been overwritten in the
+// meantime.
+static void write_trace_ring(FILE *out, struct trace_ring *ring,
+    struct trace_event *copy, int pid, double ticks_per_us) {
+  uint32_t start, end, valid_start, i;
+
+  end = (uint32_t)SDL_AtomicGet(&ring->write_count);
+  start = end > EVENT_TRACE_RING_SIZE ? end - EVENT_TRACE_RING_SIZE : 0;
+
+  for (i=start; i!=end; i++)
+    copy[i & EVENT_TRACE_RING_MASK] = ring->events[i & EVENT_TRACE_RING_MASK];
+
+  valid_start = (uint32_t)SDL_AtomicGet(&ring->write_count);
+  valid_start
+    = valid_start > EVENT_TRACE_RING_SIZE
+    ? valid_start - EVENT_TRACE_RING_SIZE
+    : 0;
+  if ((int32_t)(valid_start - start) > 0)
+    start = valid_start;
+
+  if (ring->thread_name != NULL) {
+    fprintf(out,
+        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%lu,"
+        "\"args\":{\"name\":\"%s\"}}",
+        pid, (unsigned long)ring->thread_id, ring->thread_name);
+  }
+
+  for (i=start; (int32_t)(end - i) > 0; i++)
+    write_trace_event(out, &copy[i & EVENT_TRACE_RING_MASK], pid,
+        ring->thread_id, ticks_per_us);
+}
+
+
+static void write_event_trace() {
+  char filename[PROFILE_FILENAME_BUF_SIZE];
+  struct trace_event *copy;
+  struct trace_ring *ring;
+  double ticks_per_us;
+  FILE *out;
+  int pid = (int)getpid();
+
+  expand_profile_filename(
+      event_trace_filename, filename, PROFILE_FILENAME_BUF_SIZE);
+  if ((out = fopen(filename, "w")) == NULL) {
+    TRACE_LOG("Could not open \"%s\".\n", filename);
+    return;
+  }
+
+  copy = fizmo_malloc(sizeof(struct trace_event) * EVENT_TRACE_RING_SIZE);
+  ticks_per_us = (double)SDL_GetPerformanceFrequency() / 1000000;
+
+  fprintf(out,
+      "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+      "\"args\":{\"name\":\"fizmo-sdl2\"}}",
+      pid);
+
+  SDL_LockMutex(trace_ring_list_mutex);
+  for (ring = trace_rings; ring != NULL; ring = ring->next)
+    write_trace_ring(out, ring, copy, pid, ticks_per_us);
+  SDL_UnlockMutex(trace_ring_list_mutex);
+
+  fputs("\n]}\n", out);
+  fclose(out);
+  free(copy);
+
+  TRACE_LOG("Wrote event trace to \"%s\".\n", filename);
+}
+
+
+void handle_event_trace_signal() {
+  if ( (event_trace_signal_received == 0) || (event_tracing_enabled == false) )
+    return;
+
+  event_trace_signal_received = 0;
+  write_event_trace();
+}
+
+
+void stop_event_trace() {
+  if (event_tracing_enabled == false)
+    return;
+
+  write_event_trace();
+  event_tracing_enabled = false;
+  signal(SIGUSR1, SIG_DFL);
+}
+
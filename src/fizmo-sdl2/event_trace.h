@@ -0,0 +1,131 @@
+/* event_trace.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ * A tracer which records timestamped binary events into a ring per
+ * thread and writes them out in the Chrome trace event format, which
+ * both chrome://tracing and Perfetto can load. Unlike TRACE_LOG, it's
+ * always compiled in and turned on at runtime by setting a trace
+ * filename. Recording an event doesn't take any lock or format anything,
+ * and once a thread's ring is full its oldest events are overwritten,
+ * so the trace covers the last moments before it was written.
+ *
+ * The trace is written when the interpreter exits, and whenever the
+ * process receives SIGUSR1.
+ *
+ */
+
+
+#ifndef event_trace_h_INCLUDED
+#define event_trace_h_INCLUDED
+
+#include <tools/types.h>
+
+// Events kept per thread, a power of two.
+#define EVENT_TRACE_RING_SIZE 65536
+
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END 'E'
+#define TRACE_PHASE_INSTANT 'i'
+#define TRACE_PHASE_COUNTER 'C'
+
+enum trace_event_id {
+  TRACE_GET_NEXT_EVENT,
+  TRACE_PUSH_SDL_EVENT,
+  TRACE_UPDATE_SCREEN,
+  TRACE_DO_UPDATE_SCREEN,
+  TRACE_UPLOAD_ROWS,
+  TRACE_PRESENT_FRAME,
+  TRACE_RESIZE1,
+  TRACE_RESIZE2,
+  TRACE_EVENT_QUEUE_LENGTH,
+  TRACE_WAIT_MAIN_THREAD_MUTEX,
+  TRACE_WAIT_BACKUP_SURFACE_MUTEX,
+  TRACE_WAIT_EVENT_QUEUE_MUTEX,
+  TRACE_WAIT_RESIZE_MUTEX,
+  TRACE_WAIT_TIMEOUT_SEMAPHORE,
+  TRACE_WAIT_UPDATE_SCREEN_COND,
+  TRACE_WAIT_MAIN_THREAD_WORKING_COND,
+  TRACE_WAIT_WINCH_COND,
+  NUMBER_OF_TRACE_EVENTS
+};
+
+// A "%p" in the filename is replaced by the process ID, so that batch
+// workers don't overwrite each other's traces. NULL turns tracing off.
+void set_event_trace_filename(char *filename);
+char *get_event_trace_filename();
+
+// Turns tracing on in case a filename has been set and installs the
+// SIGUSR1 handler.
+void start_event_trace();
+
+// Writes the trace and turns tracing off.
+void stop_event_trace();
+
+// To be called in a forked child, whose trace would never be written.
+void disable_event_trace();
+
+// Names the calling thread in the trace, otherwise only its ID is shown.
+void set_event_trace_thread_name(char *name);
+
+// Writes the trace in case SIGUSR1 has been received since the last call.
+// Must be called periodically from the main thread.
+void handle_event_trace_signal();
+
+// The checks are inlined, so that a disabled tracer costs no more than
+// a branch.
+extern bool event_tracing_enabled;
+
+void record_trace_event(enum trace_event_id id, char phase, uint32_t arg);
+
+static inline void trace_begin(enum trace_event_id id, uint32_t arg) {
+  if (event_tracing_enabled == true)
+    record_trace_event(id, TRACE_PHASE_BEGIN, arg);
+}
+
+static inline void trace_end(enum trace_event_id id) {
+  if (event_tracing_enabled == true)
+    record_trace_event(id, TRACE_PHASE_END, 0);
+}
+
+static inline void trace_instant(enum trace_event_id id, uint32_t arg) {
+  if (event_tracing_enabled == true)
+    record_trace_event(id, TRACE_PHASE_INSTANT, arg);
+}
+
+static inline void trace_counter(enum trace_event_id id, uint32_t value) {
+  if (event_tracing_enabled == true)
+    record_trace_event(id, TRACE_PHASE_COUNTER, value);
+}
+
+#endif // event_trace_h_INCLUDED
+
@@ -100,6 +100,9 @@
 #include <string.h>
 #include <strings.h>
 #include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
 
 #include <SDL2/SDL.h>
 
@@ -127,19 +130,51 @@
 
 #include "../locales/fizmo_sdl2_locales.h"
 #include "../locales/locale_data.h"
+#include "batch_runner.h"
+#include "mmap_filesys.h"
+#include "blorb_index.h"
+#include "image_cache.h"
+#include "image_loader.h"
+#include "framebuffer.h"
+#include "band_pool.h"
+#include "damage_tracker.h"
+#include "scrollback_cache.h"
+#include "smooth_scroll.h"
+#include "cursor_overlay.h"
+#include "sdl2_sound.h"
+#include "event_trace.h"
+#include "lock_profiler.h"
+#include "perf_hud.h"
+#include "perf_counters.h"
+#include "overdraw_view.h"
 
 #define FIZMO_SDL_VERSION "0.9.0"
 
 #define SDL_OUTPUT_CHAR_BUF_SIZE 80
+#define ZYGOTE_REQUEST_BUF_SIZE 4096
+#define CONFIG_VALUE_BUF_SIZE 32
 #define MINIMUM_X_WINDOW_SIZE 200
 #define MINIMUM_Y_WINDOW_SIZE 100
 
 static char* interface_name = "sdl2";
 
 static char *config_option_names[] = {
-  "process-sdl2-events", NULL };
+  "process-sdl2-events", "disable-mmap",
+  "image-cache-size", "image-loader-threads", "indexed-framebuffer",
+  "render-threads", "presentation-backend", "render-scale",
+  "render-scale-filter", "scrollback-cache-pages",
+  "smooth-scroll", "cursor-overlay", "cursor-blink-interval",
+  "event-trace-file", "lock-profile", "counters-report",
+  "overdraw-view", NULL };
 static char* sdl2_event_processing_queue_option_name = "queue";
 static char* sdl2_event_processing_filter_option_name = "filter";
+static char* presentation_backend_auto_option_name = "auto";
+static char* presentation_backend_renderer_option_name = "renderer";
+static char* presentation_backend_window_surface_option_name
+  = "window-surface";
+static char* render_scale_filter_nearest_option_name = "nearest";
+static char* render_scale_filter_linear_option_name = "linear";
+static char* render_scale_filter_best_option_name = "best";
 
 static SDL_Window *sdl_window = NULL;
 static SDL_Renderer *sdl_renderer = NULL;
@@ -153,6 +188,15 @@ static int unscaled_sdl2_interface_screen_width_in_pixels = 600;
 static int scaled_sdl2_interface_screen_height_in_pixels = 800;
 static int scaled_sdl2_interface_screen_width_in_pixels = 600;
 static double sdl2_device_to_pixel_ratio = 1;
+// To keep frame times down on large displays, the screen may be
+// rasterized at a fraction of the device resolution and upscaled on
+// presentation. The render scale is included in the device to pixel
+// ratio reported to libpixelif.
+static double render_scale = 1;
+static char *render_scale_filter = NULL;
+// Size of "sdlTexture", for use by the main thread.
+static int framebuffer_texture_width = 0;
+static int framebuffer_texture_height = 0;
 static SDL_TimerID timeout_timer;
 //static SDL_TimerID collection_timer;
 static bool timeout_timer_exists;
@@ -218,12 +262,86 @@ static bool filter_is_waiting_for_interpreter_screen_update = false;
 
 static bool interpreter_history_was_remeasured = false;
 
+// Headless sessions run on SDL's dummy video and audio drivers and are
+// fed from a command script instead of the keyboard. Once the script is
+// exhausted, the next blocking input request ends the session.
+static bool headless_session = false;
+static bool quit_when_input_exhausted = false;
+// Set in case the session was ended because scripted input ran out.
+static bool quit_on_exhausted_input = false;
+static char *scripted_input_filename = NULL;
+static long number_of_input_lines_processed = 0;
+static long number_of_frames_rendered = 0;
+
+// In zygote mode, the story is started once in a headless session. When
+// it first asks for input, the interpreter thread stops and forks a new
+// session for every request read from stdin. The forked children only
+// consist of the interpreter thread, so they must never wait for the
+// main thread.
+static bool zygote_mode = false;
+static bool running_in_zygote_child = false;
+// The story's text only ends up in the framebuffer, which a child never
+// presents. The zygote thus keeps a transcript from the story's start,
+// which every child continues in its own output file.
+static char *zygote_transcript_filename = NULL;
+static int zygote_transcript_fd = -1;
+static int zygote_boot_transcript_fd = -1;
+// While forking, the main thread is parked outside of SDL, so that the
+// child doesn't inherit any of SDL's internal locks in a held state.
+static bool main_thread_should_park = false;
+static bool main_thread_is_parked = false;
+
+// When the interpreter last received input, for the counters report.
+static Uint64 interpreter_turn_start = 0;
+
+static bool mmap_loading_disabled = false;
+static char config_value_buf[CONFIG_VALUE_BUF_SIZE];
+static Uint32 window_icon_loaded_event_type = (Uint32)-1;
+
+// Frames are either presented via a streaming texture and SDL's renderer,
+// or -- when there's no accelerated renderer -- by copying only the
+// regions which have changed since the last frame into the window
+// surface. In "auto" mode, "presentation_backend" is replaced by the
+// backend actually chosen at startup.
+static char *presentation_backend = NULL;
+static bool presenting_via_window_surface = false;
+
 // handle SQL_Quit?
 
 
 
+// Invoked by the interpreter thread once a colour doesn't fit into the
+// indexed framebuffer's palette anymore.
+static void leave_indexed_framebuffer_mode() {
+  if ((Surf_Display = convert_framebuffer_to_truecolour(Surf_Display))
+      == NULL) {
+    i18n_translate_and_exit(
+        fizmo_sdl2_module_name,
+        i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+        -1,
+        "SDL_ConvertSurfaceFormat");
+  }
+}
+
+
 static void draw_rgb_pixel(int y, int x, uint8_t r, uint8_t g, uint8_t b) {
   Uint32 *bufp;
+  int palette_index;
+
+  add_to_perf_counter(COUNTER_DRAW_RGB_PIXEL_CALLS, 1);
+  mark_damaged_pixel(x, y);
+  count_overdrawn_pixel(x, y);
+  cursor_text_pixel_drawn(x, y);
+
+  if (Surf_Display->format->BytesPerPixel == 1) {
+    if ((palette_index = map_framebuffer_colour(r, g, b))
+        != FRAMEBUFFER_PALETTE_FULL) {
+      *((Uint8*)Surf_Display->pixels + y*Surf_Display->pitch + x)
+        = palette_index;
+      return;
+    }
+    leave_indexed_framebuffer_mode();
+  }
 
   bufp = (Uint32 *)Surf_Display->pixels
     + y*Surf_Display->pitch/4 + x;
@@ -451,6 +569,36 @@ static void print_startup_syntax() {
       i18n_sdl2_PROCESS_SDL2_EVENTS);
   streams_latin1_output("\n");
 
+  streams_latin1_output( " -bm, --batch-manifest: ");
+  i18n_translate(
+      fizmo_sdl2_module_name,
+      i18n_sdl2_RUN_BATCH_MANIFEST);
+  streams_latin1_output("\n");
+
+  streams_latin1_output( " -bw, --batch-workers: ");
+  i18n_translate(
+      fizmo_sdl2_module_name,
+      i18n_sdl2_SET_NUMBER_OF_BATCH_WORKERS);
+  streams_latin1_output("\n");
+
+  streams_latin1_output( " -sb, --sound-benchmark: ");
+  i18n_translate(
+      fizmo_sdl2_module_name,
+      i18n_sdl2_RUN_SOUND_BENCHMARK);
+  streams_latin1_output("\n");
+
+  streams_latin1_output( " -cr, --counters-report: ");
+  i18n_translate(
+      fizmo_sdl2_module_name,
+      i18n_sdl2_WRITE_COUNTERS_REPORT_TO_FILE);
+  streams_latin1_output("\n");
+
+  streams_latin1_output( " -zy, --zygote: ");
+  i18n_translate(
+      fizmo_sdl2_module_name,
+      i18n_sdl2_FORK_SESSIONS_ON_REQUEST_FROM_STDIN);
+  streams_latin1_output("\n");
+
   streams_latin1_output( " -h,  --help: ");
   i18n_translate(
       fizmo_sdl2_module_name,
@@ -461,8 +609,45 @@ static void print_startup_syntax() {
 }
 
 
+// Parses a non-negative integer config value into *result and frees the
+// value. Returns 0 on success and -1 for empty or invalid values.
+static int parse_non_negative_config_value(char *value, long *result) {
+  char *endptr;
+  long long_value;
+
+  if ( (value == NULL) || (strlen(value) == 0) ) {
+    free(value);
+    return -1;
+  }
+  long_value = strtol(value, &endptr, 10);
+  if ( (*endptr != 0) || (long_value < 0) ) {
+    free(value);
+    return -1;
+  }
+  free(value);
+  *result = long_value;
+  return 0;
+}
+
+
+// Parses a boolean config value and frees it. An empty value enables the
+// option, just like "true" does.
+static bool parse_bool_config_value(char *value) {
+  bool result
+    = ( (value == NULL)
+        || (*value == 0)
+        || (strcasecmp(value, "true") == 0) )
+    ? true
+    : false;
+
+  free(value);
+  return result;
+}
+
+
 static int parse_config_parameter(char *key, char *value) {
   long long_value;
+  double double_value;
   char *endptr;
 
   if (strcasecmp(key, "process-sdl2-events") == 0) {
@@ -478,14 +663,144 @@ static int parse_config_parameter(char *key, char *value) {
       return -1;
     }
   }
+  else if (strcasecmp(key, "disable-mmap") == 0) {
+    mmap_loading_disabled = parse_bool_config_value(value);
+    return 0;
+  }
+  else if (strcasecmp(key, "image-cache-size") == 0) {
+    if (parse_non_negative_config_value(value, &long_value) != 0)
+      return -1;
+    set_image_cache_budget((size_t)long_value * 1024);
+    return 0;
+  }
+  else if (strcasecmp(key, "indexed-framebuffer") == 0) {
+    set_indexed_framebuffer_enabled(parse_bool_config_value(value));
+    return 0;
+  }
+  else if (strcasecmp(key, "image-loader-threads") == 0) {
+    if (parse_non_negative_config_value(value, &long_value) != 0)
+      return -1;
+    set_number_of_image_loader_threads(long_value);
+    return 0;
+  }
+  else if (strcasecmp(key, "render-threads") == 0) {
+    if (parse_non_negative_config_value(value, &long_value) != 0)
+      return -1;
+    set_number_of_band_pool_threads(long_value);
+    return 0;
+  }
+  else if (strcasecmp(key, "event-trace-file") == 0) {
+    if ( (value == NULL) || (strlen(value) == 0) ) {
+      free(value);
+      return -1;
+    }
+    set_event_trace_filename(value);
+    free(value);
+    return 0;
+  }
+  else if (strcasecmp(key, "lock-profile") == 0) {
+    set_lock_profiling_enabled(parse_bool_config_value(value));
+    return 0;
+  }
+  else if (strcasecmp(key, "counters-report") == 0) {
+    if ( (value == NULL) || (strlen(value) == 0) ) {
+      free(value);
+      return -1;
+    }
+    set_counters_report_filename(value);
+    free(value);
+    return 0;
+  }
+  else if (strcasecmp(key, "overdraw-view") == 0) {
+    if (value == NULL)
+      return -1;
+    if (set_overdraw_view(value) != 0) {
+      free(value);
+      return -1;
+    }
+    free(value);
+    return 0;
+  }
+  else if (strcasecmp(key, "cursor-overlay") == 0) {
+    set_cursor_overlay_enabled(parse_bool_config_value(value));
+    return 0;
+  }
+  else if (strcasecmp(key, "cursor-blink-interval") == 0) {
+    if (parse_non_negative_config_value(value, &long_value) != 0)
+      return -1;
+    set_cursor_blink_interval(long_value);
+    return 0;
+  }
+  else if (strcasecmp(key, "smooth-scroll") == 0) {
+    set_smooth_scrolling_enabled(parse_bool_config_value(value));
+    return 0;
+  }
+  else if (strcasecmp(key, "scrollback-cache-pages") == 0) {
+    if (parse_non_negative_config_value(value, &long_value) != 0)
+      return -1;
+    set_scrollback_cache_size(long_value);
+    return 0;
+  }
+  else if (strcasecmp(key, "render-scale") == 0) {
+    if ( (value == NULL) || (strlen(value) == 0) ) {
+      free(value);
+      return -1;
+    }
+    double_value = strtod(value, &endptr);
+    if ( (*endptr != 0) || (double_value <= 0) || (double_value > 1) ) {
+      free(value);
+      return -1;
+    }
+    free(value);
+    render_scale = double_value;
+    return 0;
+  }
+  else if (strcasecmp(key, "render-scale-filter") == 0) {
+    if (value == NULL)
+      return -1;
+    if (strcasecmp(value, render_scale_filter_nearest_option_name) == 0)
+      render_scale_filter = render_scale_filter_nearest_option_name;
+    else if (strcasecmp(value, render_scale_filter_linear_option_name) == 0)
+      render_scale_filter = render_scale_filter_linear_option_name;
+    else if (strcasecmp(value, render_scale_filter_best_option_name) == 0)
+      render_scale_filter = render_scale_filter_best_option_name;
+    else {
+      free(value);
+      return -1;
+    }
+    free(value);
+    return 0;
+  }
+  else if (strcasecmp(key, "presentation-backend") == 0) {
+    if (value == NULL)
+      return -1;
+    if (strcasecmp(value, presentation_backend_auto_option_name) == 0)
+      presentation_backend = presentation_backend_auto_option_name;
+    else if (strcasecmp(value, presentation_backend_renderer_option_name)
+        == 0)
+      presentation_backend = presentation_backend_renderer_option_name;
+    else if (strcasecmp(value,
+          presentation_backend_window_surface_option_name) == 0)
+      presentation_backend = presentation_backend_window_surface_option_name;
+    else {
+      free(value);
+      return -1;
+    }
+    free(value);
+    return 0;
+  }
   else if ( (strcasecmp(key, "window-width") == 0)
       || (strcasecmp(key, "window-height") == 0) ) {
-    if ( (value == NULL) || (strlen(value) == 0) )
+    if ( (value == NULL) || (strlen(value) == 0) ) {
+      free(value);
       return -1;
+    }
     long_value = strtol(value, &endptr, 10);
-    free(value);
-    if (*endptr != 0)
+    if (*endptr != 0) {
+      free(value);
       return -1;
+    }
+    free(value);
     if (strcasecmp(key, "window-width") == 0)
       unscaled_sdl2_interface_screen_width_in_pixels = long_value;
     else
@@ -504,6 +819,69 @@ static char *get_config_value(char *key) {
       ?  sdl2_event_processing_filter_option_name
       :  sdl2_event_processing_queue_option_name;
   }
+  else if (strcasecmp(key, "disable-mmap") == 0) {
+    return mmap_loading_disabled == true ? "true" : "false";
+  }
+  else if (strcasecmp(key, "image-cache-size") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%zu",
+        get_image_cache_budget() / 1024);
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "indexed-framebuffer") == 0) {
+    return is_indexed_framebuffer_enabled() == true ? "true" : "false";
+  }
+  else if (strcasecmp(key, "image-loader-threads") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%d",
+        get_number_of_image_loader_threads());
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "render-threads") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%d",
+        get_number_of_band_pool_threads());
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "event-trace-file") == 0) {
+    return get_event_trace_filename();
+  }
+  else if (strcasecmp(key, "lock-profile") == 0) {
+    return is_lock_profiling_enabled() == true ? "true" : "false";
+  }
+  else if (strcasecmp(key, "counters-report") == 0) {
+    return get_counters_report_filename();
+  }
+  else if (strcasecmp(key, "overdraw-view") == 0) {
+    return get_overdraw_view();
+  }
+  else if (strcasecmp(key, "cursor-overlay") == 0) {
+    return is_cursor_overlay_enabled() == true ? "true" : "false";
+  }
+  else if (strcasecmp(key, "cursor-blink-interval") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%d",
+        get_cursor_blink_interval());
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "smooth-scroll") == 0) {
+    return is_smooth_scrolling_enabled() == true ? "true" : "false";
+  }
+  else if (strcasecmp(key, "scrollback-cache-pages") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%d",
+        get_scrollback_cache_size());
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "render-scale") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%g", render_scale);
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "render-scale-filter") == 0) {
+    return render_scale_filter != NULL
+      ? render_scale_filter
+      : render_scale_filter_linear_option_name;
+  }
+  else if (strcasecmp(key, "presentation-backend") == 0) {
+    return presentation_backend != NULL
+      ? presentation_backend
+      : presentation_backend_auto_option_name;
+  }
   else {
     return NULL;
   }
@@ -515,95 +893,61 @@ static char **get_config_option_names() {
 }
 
 
-static void set_title_and_icon() {
-  z_image *frontispiece;
-  z_image *window_icon_zimage;
-  uint32_t *icon_pixels;
-  int x, y, pixel_left_shift;
-  uint8_t red, green, blue;
-  uint8_t *image_data;
-  SDL_Surface *icon_surface;
-
+static void set_title() {
   SDL_SetWindowTitle(sdl_window, story_title);
+}
 
-  if (frontispiece_resource_number >= 0) {
-    TRACE_LOG("frontispiece resnum: %d.\n", frontispiece_resource_number);
-    if ((frontispiece = get_blorb_image(frontispiece_resource_number))!=NULL) {
-      if ( (frontispiece->image_type == DRILBO_IMAGE_TYPE_RGB)
-          || (frontispiece->image_type != DRILBO_IMAGE_TYPE_GRAYSCALE) ) {
-
-        pixel_left_shift = 8 - frontispiece->bits_per_sample;
-
-        window_icon_zimage = scale_zimage(
-            frontispiece,
-            128,
-            128);
-
-        icon_pixels = fizmo_malloc(sizeof(uint32_t) * 128 * 128);
 
-        image_data = window_icon_zimage->data;
+// Invoked by the main thread once the window icon has been loaded.
+static void set_icon(cached_image *window_icon) {
+  SDL_Surface *icon_surface;
 
-        for (y=0; y<128; y++) {
-          for (x=0; x<128; x++) {
+  icon_surface = SDL_CreateRGBSurfaceFrom(
+      window_icon->pixels,
+      window_icon->width,
+      window_icon->height,
+      32,
+      sizeof(uint32_t) * window_icon->width,
+      0x00ff0000,
+      0x0000ff00,
+      0x000000ff,
+      0xff000000);
+
+  SDL_SetWindowIcon(sdl_window, icon_surface);
+
+  SDL_FreeSurface(icon_surface);
+  release_cached_image(window_icon);
+}
 
-            red = *(image_data++);
 
-            if (window_icon_zimage->image_type == DRILBO_IMAGE_TYPE_RGB) {
-              green = *(image_data++);
-              blue = *(image_data++);
+// Invoked by an image loader thread, which may not touch the window, so
+// the icon is handed over to the main thread's event loop.
+static void window_icon_loaded(cached_image *window_icon,
+    void *UNUSED(callback_data)) {
+  SDL_Event event;
 
-              if (pixel_left_shift > 0) {
-                red <<= pixel_left_shift;
-                green <<= pixel_left_shift;
-                blue <<= pixel_left_shift;
-              }
-              else if (pixel_left_shift < 0) {
-                red >>= pixel_left_shift;
-                green >>= pixel_left_shift;
-                blue >>= pixel_left_shift;
-              }
+  if (window_icon == NULL)
+    return;
 
-              icon_pixels[y*128+x]
-                = (red << 24) | (green << 16) | (blue << 8);
-            }
-            else if (window_icon_zimage->image_type
-                == DRILBO_IMAGE_TYPE_GRAYSCALE) {
+  SDL_zero(event);
+  event.type = window_icon_loaded_event_type;
+  event.user.data1 = window_icon;
+  if (SDL_PushEvent(&event) != 1)
+    release_cached_image(window_icon);
+}
 
-              if (pixel_left_shift > 0) {
-                red <<= pixel_left_shift;
-              }
-              else if (pixel_left_shift < 0) {
-                red >>= pixel_left_shift;
-              }
 
-              icon_pixels[y*128+x]
-                = (red << 24) | (red << 16) | (red << 8);
-            }
-          }
-        }
+// Icons which were loaded after the main loop had stopped processing
+// events still hold a reference to their cache entry.
+static void release_pending_window_icons() {
+  SDL_Event event;
 
-        icon_surface = SDL_CreateRGBSurfaceFrom(
-            icon_pixels,
-            128,
-            128,
-            32,
-            sizeof(uint32_t) * 128,
-            0xff000000,
-            0x00ff0000,
-            0x0000ff00,
-            0x00000000);
-
-        SDL_SetWindowIcon(sdl_window, icon_surface);
-
-        SDL_FreeSurface(icon_surface);
-        free_zimage(window_icon_zimage);
-        window_icon_zimage= NULL;
-      }
+  if (window_icon_loaded_event_type == (Uint32)-1)
+    return;
 
-      free_zimage(frontispiece);
-      frontispiece = NULL;
-    }
-  }
+  while (SDL_PeepEvents(&event, 1, SDL_GETEVENT,
+        window_icon_loaded_event_type, window_icon_loaded_event_type) == 1)
+    release_cached_image(event.user.data1);
 }
 
 
@@ -612,6 +956,11 @@ static void link_interface_to_story(struct z_story *story) {
 
   story_title = story->title;
 
+  // libfizmo looks for a blorb file next to the story on its own in case
+  // none was given, so the index has to use whichever file it opened.
+  if ( (story->blorb_file != NULL) && (story->blorb_file->filename != NULL) )
+    set_blorb_index_file(story->blorb_file->filename);
+
   resource_number
     = active_blorb_interface->get_frontispiece_resource_number(
         active_z_story->blorb_map);
@@ -619,17 +968,32 @@ static void link_interface_to_story(struct z_story *story) {
   frontispiece_resource_number
     = resource_number >= 0 ? resource_number : -1;
 
+  if ( (frontispiece_resource_number >= 0)
+      && (window_icon_loaded_event_type != (Uint32)-1) ) {
+    TRACE_LOG("frontispiece resnum: %d.\n", frontispiece_resource_number);
+    load_blorb_image_async(
+        frontispiece_resource_number,
+        128,
+        128,
+        SDL_PIXELFORMAT_ARGB8888,
+        &window_icon_loaded,
+        NULL);
+  }
+
   TRACE_LOG("Waiting for sdl_main_thread_working_mutex.\n");
-  SDL_LockMutex(sdl_main_thread_working_mutex);
+  lock_profiled_mutex(sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
   TRACE_LOG("Locked sdl_main_thread_working_mutex.\n");
   main_thread_should_set_title = true;
   main_thread_work_complete = false;
   while (main_thread_work_complete == false) {
     TRACE_LOG("Waiting for sdl_main_thread_working_cond ...\n");
-    SDL_CondWait(sdl_main_thread_working_cond, sdl_main_thread_working_mutex);
+    wait_profiled_cond(
+        sdl_main_thread_working_cond, COND_MAIN_THREAD_WORKING,
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
   }
   TRACE_LOG("Found sdl_main_thread_working_cond.\n");
-  SDL_UnlockMutex(sdl_main_thread_working_mutex);
+  unlock_profiled_mutex(
+      sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
 }
 
 
@@ -678,8 +1042,40 @@ static double get_device_to_pixel_ratio() {
 }
 
 
+static SDL_ScaleMode get_render_scale_mode() {
+  // "best" is anisotropic filtering where the renderer supports it and
+  // the same as "linear" otherwise.
+  return render_scale_filter == render_scale_filter_nearest_option_name
+    ? SDL_ScaleModeNearest
+    : render_scale_filter == render_scale_filter_best_option_name
+    ? SDL_ScaleModeBest
+    : SDL_ScaleModeLinear;
+}
+
+
+static SDL_Texture *create_framebuffer_texture() {
+  SDL_Texture *result;
+
+  if ((result = SDL_CreateTexture(sdl_renderer,
+          SDL_PIXELFORMAT_ARGB8888,
+          SDL_TEXTUREACCESS_STREAMING,
+          scaled_sdl2_interface_screen_width_in_pixels,
+          scaled_sdl2_interface_screen_height_in_pixels)) == NULL)
+    return NULL;
+
+  SDL_SetTextureScaleMode(result, get_render_scale_mode());
+  framebuffer_texture_width = scaled_sdl2_interface_screen_width_in_pixels;
+  framebuffer_texture_height = scaled_sdl2_interface_screen_height_in_pixels;
+
+  return result;
+}
+
+
 static void process_resize2() {
-  SDL_LockMutex(sdl_backup_surface_mutex);
+  trace_begin(TRACE_RESIZE2, 0);
+  lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+
+  invalidate_scrollback_cache();
 
   TRACE_LOG("process_resize2: %d / %d\n",
       unscaled_sdl2_interface_screen_width_in_pixels,
@@ -689,16 +1085,18 @@ static void process_resize2() {
       unscaled_sdl2_interface_screen_width_in_pixels,
       unscaled_sdl2_interface_screen_height_in_pixels);
 
-  SDL_FreeSurface(Surf_Backup);
-  if ((Surf_Backup = SDL_CreateRGBSurface(
-          0,
+  if (presenting_via_window_surface == true) {
+    // The window surface is recreated by SDL itself on the next
+    // SDL_GetWindowSurface call.
+    unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+    trace_end(TRACE_RESIZE2);
+    return;
+  }
+
+  free_framebuffer_surface(Surf_Backup);
+  if ((Surf_Backup = create_framebuffer_surface(
           scaled_sdl2_interface_screen_width_in_pixels,
-          scaled_sdl2_interface_screen_height_in_pixels,
-          32,
-          0x00FF0000,
-          0x0000FF00,
-          0x000000FF,
-          0xFF000000)) == NULL) {
+          scaled_sdl2_interface_screen_height_in_pixels)) == NULL) {
     i18n_translate_and_exit(
         fizmo_sdl2_module_name,
         i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
@@ -707,11 +1105,7 @@ static void process_resize2() {
   }
 
   SDL_DestroyTexture(sdlTexture);
-  if ((sdlTexture = SDL_CreateTexture(sdl_renderer,
-          SDL_PIXELFORMAT_ARGB8888,
-          SDL_TEXTUREACCESS_STREAMING,
-          scaled_sdl2_interface_screen_width_in_pixels,
-          scaled_sdl2_interface_screen_height_in_pixels)) == NULL) {
+  if ((sdlTexture = create_framebuffer_texture()) == NULL) {
     i18n_translate_and_exit(
         fizmo_sdl2_module_name,
         i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
@@ -719,12 +1113,22 @@ static void process_resize2() {
         "SDL_CreateTexture");
   }
 
-  SDL_UnlockMutex(sdl_backup_surface_mutex);
+  unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+  trace_end(TRACE_RESIZE2);
 }
 
 
 void update_screen() {
+  Uint64 start;
+
   TRACE_LOG("Doing update_screen().\n");
+  add_to_perf_counter(COUNTER_UPDATE_SCREEN_REQUESTS, 1);
+
+  if (running_in_zygote_child == true) {
+    // There's no main thread left to present the frame.
+    number_of_frames_rendered++;
+    return;
+  }
 
   // This thread is executed in the interpreter's context. This means
   // we have to notify the main sdl thread that we want the screen
@@ -738,8 +1142,10 @@ void update_screen() {
   // by ths method, since the main event loop is blocked in this kind
   // of SDL implementation (which generally means Mac OS X).
 
+  trace_begin(TRACE_UPDATE_SCREEN, 0);
+  start = SDL_GetPerformanceCounter();
   TRACE_LOG("Waiting for sdl_main_thread_working_mutex.\n");
-  SDL_LockMutex(sdl_main_thread_working_mutex);
+  lock_profiled_mutex(sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
   TRACE_LOG("Locked sdl_main_thread_working_mutex.\n");
 
   TRACE_LOG("filter_is_waiting_for_interpreter_screen_update: %d\n",
@@ -765,7 +1171,9 @@ void update_screen() {
     while ( (main_thread_should_update_screen == false)
         && (filter_is_waiting_for_interpreter_screen_update == false) ) {
       TRACE_LOG("Waiting for update_screen_wait_cond ...\n");
-      SDL_CondWait(update_screen_wait_cond, sdl_main_thread_working_mutex);
+      wait_profiled_cond(
+          update_screen_wait_cond, COND_UPDATE_SCREEN_WAIT,
+          sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
       TRACE_LOG("Found for update_screen_wait_cond.\n");
     }
 
@@ -781,7 +1189,11 @@ void update_screen() {
 
   }
 
-  SDL_UnlockMutex(sdl_main_thread_working_mutex);
+  unlock_profiled_mutex(
+      sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+  perf_hud_screen_updated(SDL_GetPerformanceCounter() - start);
+  stop_perf_timer(TIMER_UPDATE_SCREEN, start);
+  trace_end(TRACE_UPDATE_SCREEN);
 
   TRACE_LOG("Finished update_screen().\n");
 
@@ -833,6 +1245,9 @@ void update_screen() {
 
 
 static void process_resize1() {
+  trace_begin(TRACE_RESIZE1, 0);
+  perf_hud_resize_started();
+  add_to_perf_counter(COUNTER_RESIZES, 1);
 
   unscaled_sdl2_interface_screen_width_in_pixels = resize_event_new_x_size;
   unscaled_sdl2_interface_screen_height_in_pixels = resize_event_new_y_size;
@@ -849,22 +1264,26 @@ static void process_resize1() {
       unscaled_sdl2_interface_screen_width_in_pixels,
       unscaled_sdl2_interface_screen_height_in_pixels);
 
-  SDL_FreeSurface(Surf_Display);
-  if ((Surf_Display = SDL_CreateRGBSurface(
-          0,
+  free_framebuffer_surface(Surf_Display);
+  if ((Surf_Display = create_framebuffer_surface(
           scaled_sdl2_interface_screen_width_in_pixels,
-          scaled_sdl2_interface_screen_height_in_pixels,
-          32,
-          0x00FF0000,
-          0x0000FF00,
-          0x000000FF,
-          0xFF000000)) == NULL) {
+          scaled_sdl2_interface_screen_height_in_pixels)) == NULL) {
     i18n_translate_and_exit(
         fizmo_sdl2_module_name,
         i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
         -1,
         "SDL_GetWindowSurface");
   }
+
+  init_damage_tracker(
+      scaled_sdl2_interface_screen_width_in_pixels,
+      scaled_sdl2_interface_screen_height_in_pixels);
+  init_overdraw_map(
+      scaled_sdl2_interface_screen_width_in_pixels,
+      scaled_sdl2_interface_screen_height_in_pixels);
+  reset_scroll_region();
+
+  trace_end(TRACE_RESIZE1);
 }
 
 
@@ -899,17 +1318,18 @@ static int pull_sdl_event_from_queue(int *event_type, z_ucs *z_ucs_input) {
   // window-resizes seperately (since resizing blocks the event queue in SDL's
   // Mac OS X implementation.
 
-  SDL_LockMutex(resize_event_pending_mutex);
+  lock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
   if (resize_event_pending == true) {
     TRACE_LOG("Gotta resize.\n");
     resize_event_has_to_be_processed = true;
     resize_event_pending = false;
   }
-  SDL_UnlockMutex(resize_event_pending_mutex);
+  unlock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
 
   if (resize_event_has_to_be_processed == true) {
     process_resize1();
     *event_type = EVENT_WAS_WINCH;
+    scrollback_event_consumed(EVENT_WAS_WINCH);
     interpreter_is_processing_winch = true;
     TRACE_LOG("interpreter_is_processing_winch = true\n");
     *z_ucs_input = 0;
@@ -919,33 +1339,53 @@ static int pull_sdl_event_from_queue(int *event_type, z_ucs *z_ucs_input) {
     // In case we don't have to process resizing events we check the event
     // queue.
 
-    SDL_LockMutex(sdl_event_queue_mutex);
+    lock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
 
     if (sdl_event_queue_index > 0) {
       *event_type = sdl_event_queue[0].event_type;
       *z_ucs_input = sdl_event_queue[0].z_ucs_input;
+      if ( (*event_type == EVENT_WAS_INPUT)
+          && (*z_ucs_input == Z_UCS_NEWLINE) ) {
+        number_of_input_lines_processed++;
+        perf_hud_turn_finished();
+      }
+      scrollback_event_consumed(*event_type);
       if (--sdl_event_queue_index > 0) {
         memmove(
             sdl_event_queue,
             sdl_event_queue + 1,
             sizeof(sdl_queued_event)*sdl_event_queue_index);
       }
+      perf_hud_event_queue_depth(sdl_event_queue_index);
+      add_to_perf_counter(COUNTER_EVENTS_DEQUEUED, 1);
       result = 0;
     }
     else {
       result = -1;
     }
 
-    SDL_UnlockMutex(sdl_event_queue_mutex);
+    unlock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
   }
 
   return result;
 }
 
 
+static bool is_sdl_event_queue_empty() {
+  bool result;
+
+  lock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
+  result = sdl_event_queue_index == 0;
+  unlock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
+
+  return result;
+}
+
+
 static void push_sdl_event_to_queue(int event_type, z_ucs z_ucs_input) {
   TRACE_LOG("push\n");
-  SDL_LockMutex(sdl_event_queue_mutex);
+  trace_instant(TRACE_PUSH_SDL_EVENT, event_type);
+  lock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
   if (sdl_event_queue_index == sdl_event_queue_size) {
     sdl_event_queue_size += sdl_event_queue_size_increment;
     sdl_event_queue = fizmo_realloc(
@@ -954,64 +1394,509 @@ static void push_sdl_event_to_queue(int event_type, z_ucs z_ucs_input) {
   sdl_event_queue[sdl_event_queue_index].event_type = event_type;
   sdl_event_queue[sdl_event_queue_index].z_ucs_input = z_ucs_input;
   sdl_event_queue_index++;
-  SDL_UnlockMutex(sdl_event_queue_mutex);
+  trace_counter(TRACE_EVENT_QUEUE_LENGTH, sdl_event_queue_index);
+  perf_hud_event_queue_depth(sdl_event_queue_index);
+  add_to_perf_counter(COUNTER_EVENTS_QUEUED, 1);
+  unlock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
+}
+
+
+// Pushes the contents of the given command script to the event queue,
+// exactly as if it had been typed on the keyboard. Returns false in case
+// the script could not be opened.
+static bool load_scripted_input(char *filename) {
+  z_file *script;
+  z_ucs input;
+
+  if ((script = fsi->openfile(filename, FILETYPE_DATA, FILEACCESS_READ))
+      == NULL) {
+    i18n_translate(
+        fizmo_sdl2_module_name,
+        i18n_sdl2_COULD_NOT_OPEN_OR_FIND_P0S,
+        filename);
+    streams_latin1_output("\n");
+    return false;
+  }
+
+  while ((input = parse_utf8_char_from_file(script)) != UEOF) {
+    if (input != '\r') {
+      push_sdl_event_to_queue(EVENT_WAS_INPUT, input);
+    }
+  }
+
+  fsi->closefile(script);
+  return true;
 }
 
 
 static Uint32 timeout_callback(Uint32 interval, void *UNUSED(param)) {
-  SDL_SemWait(timeout_semaphore);
+  wait_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
 
   if (timeout_timer_exists == true) {
     SDL_RemoveTimer(timeout_timer);
     timeout_timer_exists = false;
+    add_to_perf_counter(COUNTER_TIMER_FIRINGS, 1);
     push_sdl_event_to_queue(EVENT_WAS_TIMEOUT, 0);
   }
 
-  SDL_SemPost(timeout_semaphore);
+  post_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
 
   return interval;
 }
 
 
+// Copies only the damaged parts of the framebuffer into the window
+// surface. The window surface keeps its contents between frames, so it
+// doubles as the backup surface in this mode.
+static void present_via_window_surface() {
+  Uint64 start = start_perf_timer();
+  SDL_Surface *window_surface;
+  SDL_Rect *rects;
+  int nof_rects, i;
+
+  if ((window_surface = SDL_GetWindowSurface(sdl_window)) == NULL) {
+    i18n_translate_and_exit(
+        fizmo_sdl2_module_name,
+        i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+        -1,
+        "SDL_GetWindowSurface");
+  }
+
+  if ( (window_surface->w != Surf_Display->w)
+      || (window_surface->h != Surf_Display->h) ) {
+    // Either the framebuffer is rendered at a reduced scale, or the
+    // window has already been resized but the interpreter hasn't redrawn
+    // the framebuffer in the new size yet. SDL's software scaling is
+    // always nearest-neighbour, and since it has to cover the whole
+    // window, damage tracking doesn't help here.
+    collect_damaged_rects(&rects);
+    SDL_BlitScaled(Surf_Display, NULL, window_surface, NULL);
+    SDL_UpdateWindowSurface(sdl_window);
+    add_to_perf_counter(COUNTER_BYTES_UPLOADED, (uint64_t)window_surface->w
+        * window_surface->h * window_surface->format->BytesPerPixel);
+    add_to_perf_counter(COUNTER_FRAMES_PRESENTED, 1);
+    stop_perf_timer(TIMER_PRESENT_FRAME, start);
+    return;
+  }
+
+  if ((nof_rects = collect_damaged_rects(&rects)) == 0)
+    return;
+
+  TRACE_LOG("Presenting %d damaged rects.\n", nof_rects);
+
+  for (i=0; i<nof_rects; i++) {
+    SDL_BlitSurface(Surf_Display, &rects[i], window_surface, &rects[i]);
+    add_to_perf_counter(COUNTER_BYTES_UPLOADED, (uint64_t)rects[i].w
+        * rects[i].h * window_surface->format->BytesPerPixel);
+  }
+
+  SDL_UpdateWindowSurfaceRects(sdl_window, rects, nof_rects);
+  add_to_perf_counter(COUNTER_FRAMES_PRESENTED, 1);
+  stop_perf_timer(TIMER_PRESENT_FRAME, start);
+}
+
+
+static void present_frame() {
+  Uint64 start = start_perf_timer();
+  SDL_Texture *scrollback_page;
+  int output_width, output_height;
+  float x_scale, y_scale;
+
+  trace_begin(TRACE_PRESENT_FRAME, 0);
+  SDL_RenderClear(sdl_renderer);
+  if ((scrollback_page = get_displayed_scrollback_page()) != NULL) {
+    SDL_RenderCopy(sdl_renderer, scrollback_page, NULL, NULL);
+  }
+  else {
+    SDL_RenderCopy(sdl_renderer, sdlTexture, NULL, NULL);
+    SDL_GetRendererOutputSize(sdl_renderer, &output_width, &output_height);
+    x_scale = (float)output_width / framebuffer_texture_width;
+    y_scale = (float)output_height / framebuffer_texture_height;
+    render_scroll_region(x_scale, y_scale);
+    render_cursor_overlay(x_scale, y_scale);
+    render_overdraw_view(x_scale, y_scale);
+  }
+  render_perf_hud();
+  SDL_RenderPresent(sdl_renderer);
+  add_to_perf_counter(COUNTER_FRAMES_PRESENTED, 1);
+  stop_perf_timer(TIMER_PRESENT_FRAME, start);
+  trace_end(TRACE_PRESENT_FRAME);
+}
+
+
+static void page_up() {
+  int nof_events;
+
+  lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+  nof_events = scrollback_page_up(Surf_Backup, is_sdl_event_queue_empty());
+  if (nof_events == 0)
+    present_frame();
+  unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+
+  while (nof_events-- > 0)
+    push_sdl_event_to_queue(EVENT_WAS_CODE_PAGE_UP, 0);
+}
+
+
+static void page_down() {
+  int nof_events;
+
+  lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+  if ((nof_events = scrollback_page_down()) == 0)
+    present_frame();
+  unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+
+  if (nof_events > 0)
+    push_sdl_event_to_queue(EVENT_WAS_CODE_PAGE_DOWN, 0);
+}
+
+
+static void show_live_screen() {
+  lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+  if (leave_scrollback_pages() == true)
+    present_frame();
+  unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+}
+
+
 void do_update_screen() {
+  SDL_Rect *spans, scroll_region;
+  int nof_spans, i;
+
+  trace_begin(TRACE_DO_UPDATE_SCREEN, 0);
   TRACE_LOG("locking sdl_backup_surface_mutex...\n");
-  SDL_LockMutex(sdl_backup_surface_mutex);
+  lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
   TRACE_LOG("sdl_backup_surface_mutex locked\n");
 
   TRACE_LOG("Main thread updating screen.\n");
-  SDL_BlitSurface(Surf_Display, NULL, Surf_Backup, NULL);
-  SDL_UpdateTexture(
-      sdlTexture,
-      NULL,
-      Surf_Display->pixels,
-      Surf_Display->pitch);
-  SDL_RenderClear(sdl_renderer);
-  SDL_RenderCopy(sdl_renderer, sdlTexture, NULL, NULL);
-  SDL_RenderPresent(sdl_renderer);
+  number_of_frames_rendered++;
+  collect_overdraw_map();
+
+  if (presenting_via_window_surface == true) {
+    present_via_window_surface();
+    unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+    trace_end(TRACE_DO_UPDATE_SCREEN);
+    return;
+  }
+
+  if (Surf_Backup->format->format != Surf_Display->format->format) {
+    // The interpreter has left indexed mode since the last update.
+    free_framebuffer_surface(Surf_Backup);
+    if ((Surf_Backup = create_framebuffer_surface(
+            Surf_Display->w, Surf_Display->h)) == NULL) {
+      i18n_translate_and_exit(
+          fizmo_sdl2_module_name,
+          i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+          -1,
+          "SDL_CreateRGBSurface");
+    }
+    SDL_BlitSurface(Surf_Display, NULL, Surf_Backup, NULL);
+  }
 
-  SDL_UnlockMutex(sdl_backup_surface_mutex);
+  // Scrolls of the story window are done by moving the ring texture
+  // and don't show up in the damage.
+  if (apply_registered_scrolls(&scroll_region) == true)
+    SDL_BlitSurface(Surf_Display, &scroll_region, Surf_Backup, &scroll_region);
+
+  // Only the rows which have changed are copied and uploaded, so that the
+  // status line changing or the story window scrolling doesn't cost a
+  // full upload of the other window's rows.
+  nof_spans = collect_damaged_row_spans(&spans);
+  TRACE_LOG("Uploading %d damaged row spans.\n", nof_spans);
+  trace_begin(TRACE_UPLOAD_ROWS, nof_spans);
+  for (i=0; i<nof_spans; i++) {
+    SDL_BlitSurface(Surf_Display, &spans[i], Surf_Backup, &spans[i]);
+    upload_framebuffer_rows(sdlTexture, Surf_Display, spans[i].y, spans[i].h);
+    overdraw_area_uploaded(&spans[i]);
+    perf_hud_bytes_uploaded((size_t)spans[i].w * spans[i].h
+        * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888));
+    add_to_perf_counter(COUNTER_BYTES_UPLOADED, (uint64_t)spans[i].w
+        * spans[i].h * SDL_BYTESPERPIXEL(SDL_PIXELFORMAT_ARGB8888));
+    upload_scroll_region(Surf_Display, &spans[i]);
+  }
+  trace_end(TRACE_UPLOAD_ROWS);
+
+  scrollback_frame_updated(Surf_Display, nof_spans);
+  present_frame();
+
+  unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+  trace_end(TRACE_DO_UPDATE_SCREEN);
+}
+
+
+// Invoked by the main thread from its event loop, outside of any SDL
+// call. Blocks until the zygote has forked.
+static void park_main_thread() {
+  lock_profiled_mutex(sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+  main_thread_is_parked = true;
+  SDL_CondBroadcast(sdl_main_thread_working_cond);
+  while (main_thread_should_park == true)
+    wait_profiled_cond(
+        sdl_main_thread_working_cond, COND_MAIN_THREAD_WORKING,
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+  main_thread_is_parked = false;
+  unlock_profiled_mutex(
+      sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+}
+
+
+static pid_t fork_zygote_child() {
+  pid_t pid;
+
+  // Make sure no other thread is holding any of our locks while forking,
+  // since the child will only consist of the calling thread. The main
+  // thread is parked, zygotes run neither the timer nor the audio thread
+  // and load images without worker threads.
+  lock_profiled_mutex(sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+  main_thread_should_park = true;
+  while (main_thread_is_parked == false)
+    wait_profiled_cond(
+        sdl_main_thread_working_cond, COND_MAIN_THREAD_WORKING,
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+  lock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
+  wait_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
+  lock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
+  fflush(stdout);
+  fflush(stderr);
+
+  pid = fork();
+
+  if (pid == 0) {
+    detach_band_pool();
+    disable_sdl2_sound();
+    disable_event_trace();
+  }
+
+  unlock_profiled_mutex(sdl_event_queue_mutex, LOCK_EVENT_QUEUE);
+  post_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
+  unlock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
+  main_thread_should_park = false;
+  if (pid != 0)
+    SDL_CondBroadcast(sdl_main_thread_working_cond);
+  unlock_profiled_mutex(
+      sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
+
+  return pid;
+}
+
+
+// Creates the file the zygote's transcript is written to, which has to
+// happen before the story starts.
+static void prepare_zygote_transcript() {
+  char *tmp_dir, *transcript_filename;
+  size_t len;
+  int fd;
+
+  // The zygote's transcript replaces the user's, refuse to silently drop
+  // a transcript file that has been asked for.
+  if ((transcript_filename = get_configuration_value("transcript-filename"))
+      != NULL) {
+    i18n_translate(
+        fizmo_sdl2_module_name,
+        i18n_sdl2_ZYGOTE_MODE_CANNOT_WRITE_TRANSCRIPT_TO_P0S,
+        transcript_filename);
+    streams_latin1_output("\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if ( ((tmp_dir = getenv("TMPDIR")) == NULL) || (*tmp_dir == 0) )
+    tmp_dir = "/tmp";
+
+  len = strlen(tmp_dir) + 24;
+  zygote_transcript_filename = fizmo_malloc(len);
+  snprintf(zygote_transcript_filename, len, "%s/fizmo-zygote-XXXXXX",
+      tmp_dir);
+
+  if ((fd = mkstemp(zygote_transcript_filename)) == -1) {
+    TRACE_LOG("Could not create zygote transcript: %s\n", strerror(errno));
+    free(zygote_transcript_filename);
+    zygote_transcript_filename = NULL;
+    return;
+  }
+  close(fd);
+
+  set_configuration_value("transcript-filename", zygote_transcript_filename);
+  set_configuration_value("start-script-when-story-starts", "true");
+}
+
+
+// Looks up the descriptor libfizmo has opened the zygote's transcript
+// with and removes the file, which is only accessed through descriptors
+// from here on. libfizmo keeps the transcript's z_file to itself, so the
+// descriptor is found among the process' open ones.
+static void open_zygote_transcript() {
+  struct stat transcript_stat, fd_stat;
+  struct dirent *entry;
+  DIR *fd_dir;
+  char *endptr;
+  long fd;
+
+  if (zygote_transcript_filename == NULL)
+    return;
+
+  if ( ((zygote_boot_transcript_fd = open(
+            zygote_transcript_filename, O_RDONLY)) != -1)
+      && (fstat(zygote_boot_transcript_fd, &transcript_stat) == 0)
+      && ((fd_dir = opendir("/proc/self/fd")) != NULL) ) {
+    while ((entry = readdir(fd_dir)) != NULL) {
+      fd = strtol(entry->d_name, &endptr, 10);
+      if ( (*endptr == 0)
+          && (endptr != entry->d_name)
+          && (fd != zygote_boot_transcript_fd)
+          && (fd != dirfd(fd_dir))
+          && (fstat(fd, &fd_stat) == 0)
+          && (fd_stat.st_dev == transcript_stat.st_dev)
+          && (fd_stat.st_ino == transcript_stat.st_ino) ) {
+        zygote_transcript_fd = fd;
+        break;
+      }
+    }
+    closedir(fd_dir);
+  }
+
+  TRACE_LOG("Zygote transcript descriptor: %d.\n", zygote_transcript_fd);
+  unlink(zygote_transcript_filename);
+}
+
+
+// Executed in a zygote child: copies the transcript written so far to
+// the given descriptor and redirects the transcript's descriptor to it.
+// Text still buffered by libfizmo is written once it's flushed.
+static void continue_zygote_transcript(int output_fd) {
+  char buf[4096];
+  ssize_t bytes_read;
+  off_t offset = 0;
+
+  if (zygote_transcript_fd == -1)
+    return;
+
+  while ((bytes_read = pread(
+          zygote_boot_transcript_fd, buf, sizeof(buf), offset)) > 0) {
+    if (write(output_fd, buf, bytes_read) != bytes_read)
+      break;
+    offset += bytes_read;
+  }
+
+  dup2(output_fd, zygote_transcript_fd);
+  close(zygote_boot_transcript_fd);
+}
+
+
+// Executed in the interpreter thread on the story's first input request.
+// Reads lines consisting of a command script filename and an optional
+// output filename from stdin and forks a child session for each of them.
+// Returns true in the children, and false in the zygote itself once
+// stdin has been closed.
+static bool run_zygote() {
+  char request[ZYGOTE_REQUEST_BUF_SIZE];
+  char *script_filename, *output_filename, *saveptr;
+  int output_fd, null_fd;
+  pid_t pid;
+
+  // Children are never waited for, let the system reap them.
+  signal(SIGCHLD, SIG_IGN);
+  open_zygote_transcript();
+
+  while (fgets(request, ZYGOTE_REQUEST_BUF_SIZE, stdin) != NULL) {
+    if ((script_filename = strtok_r(request, " \t\r\n", &saveptr)) == NULL)
+      continue;
+    output_filename = strtok_r(NULL, " \t\r\n", &saveptr);
+
+    if ((pid = fork_zygote_child()) == -1) {
+      i18n_translate_and_exit(
+          fizmo_sdl2_module_name,
+          i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+          -1,
+          "fork");
+    }
+    else if (pid == 0) {
+      running_in_zygote_child = true;
+      signal(SIGCHLD, SIG_DFL);
+
+      if ((null_fd = open("/dev/null", O_RDONLY)) != -1) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+      }
+
+      if (output_filename != NULL) {
+        if ((output_fd = open(output_filename,
+                O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+          fprintf(stderr, "%s: %s\n", output_filename, strerror(errno));
+          _exit(EXIT_FAILURE);
+        }
+        continue_zygote_transcript(output_fd);
+        dup2(output_fd, STDOUT_FILENO);
+        dup2(output_fd, STDERR_FILENO);
+        close(output_fd);
+      }
+      else if ((output_fd = open("/dev/null", O_WRONLY)) != -1) {
+        // Stdout is reserved for the zygote's process IDs.
+        continue_zygote_transcript(output_fd);
+        close(output_fd);
+      }
+
+      // The error message ends up in the child's transcript. Exiting
+      // regularly would run SDL_Quit on the zygote's SDL state.
+      if (load_scripted_input(script_filename) == false) {
+        fflush(NULL);
+        _exit(EXIT_FAILURE);
+      }
+      quit_when_input_exhausted = true;
+      return true;
+    }
+
+    TRACE_LOG("Forked zygote child %d.\n", pid);
+    printf("%d\n", (int)pid);
+    fflush(stdout);
+  }
+
+  return false;
 }
 
 
 static int get_next_event(z_ucs *z_ucs_input, int timeout_millis,
     bool poll_only, bool history_finished_remeasuring) {
   int wait_result, result = -1;
+  Uint32 timeout_ticks = 0;
 
   TRACE_LOG("Invoked get_next_event.\n");
+  trace_begin(TRACE_GET_NEXT_EVENT, poll_only == true ? 1 : 0);
 
   if (history_finished_remeasuring == true) {
-    SDL_LockMutex(sdl_main_thread_working_mutex);
+    lock_profiled_mutex(
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
     main_thread_work_complete = false;
     interpreter_history_was_remeasured = true;
-    SDL_UnlockMutex(sdl_main_thread_working_mutex);
+    add_to_perf_counter(COUNTER_REFLOWS, 1);
+    unlock_profiled_mutex(
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
   }
 
-  if (timeout_millis > 0) {
+  if ( (zygote_mode == true) && (poll_only == false) ) {
+    zygote_mode = false;
+    if (run_zygote() == false) {
+      trace_end(TRACE_GET_NEXT_EVENT);
+      return EVENT_WAS_QUIT;
+    }
+  }
+
+  if (poll_only == false) {
+    if (interpreter_turn_start != 0)
+      stop_perf_timer(TIMER_INTERPRETER_TURN, interpreter_turn_start);
+    set_cursor_overlay_waiting_for_input(true);
+  }
+
+  if ( (timeout_millis > 0) && (running_in_zygote_child == true) ) {
+    // The timer thread didn't survive the fork, so the timeout has to
+    // be checked while polling.
+    timeout_ticks = SDL_GetTicks() + timeout_millis;
+  }
+  else if (timeout_millis > 0) {
     TRACE_LOG("input timeout: %d ms.\n", timeout_millis);
-    SDL_SemWait(timeout_semaphore);
+    wait_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
     timeout_timer = SDL_AddTimer(timeout_millis, &timeout_callback, NULL);
     timeout_timer_exists = true;
-    SDL_SemPost(timeout_semaphore);
+    post_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
   }
 
   while (true) {
@@ -1024,19 +1909,36 @@ static int get_next_event(z_ucs *z_ucs_input, int timeout_millis,
       TRACE_LOG("poll's wait_result: %d.\n", wait_result);
       break;
     }
+    if ( (timeout_ticks != 0)
+        && ((Sint32)(SDL_GetTicks() - timeout_ticks) >= 0) ) {
+      result = EVENT_WAS_TIMEOUT;
+      break;
+    }
+    if (quit_when_input_exhausted == true) {
+      TRACE_LOG("Scripted input exhausted, quitting.\n");
+      quit_on_exhausted_input = true;
+      result = EVENT_WAS_QUIT;
+      break;
+    }
     SDL_Delay(10);
   }
 
   if (timeout_millis > 0) {
-    SDL_SemWait(timeout_semaphore);
+    wait_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
     if (timeout_timer_exists == true) {
       SDL_RemoveTimer(timeout_timer);
       timeout_timer_exists = false;
     }
-    SDL_SemPost(timeout_semaphore);
+    post_profiled_semaphore(timeout_semaphore, LOCK_TIMEOUT_SEMAPHORE);
+  }
+
+  if (poll_only == false) {
+    set_cursor_overlay_waiting_for_input(false);
+    interpreter_turn_start = start_perf_timer();
   }
 
   TRACE_LOG("Returning from get_next_event.\n");
+  trace_end(TRACE_GET_NEXT_EVENT);
 
   return result;
 }
@@ -1047,61 +1949,62 @@ void redraw_screen_from_scratch() {
 
 
 void copy_area(int dsty, int dstx, int srcy, int srcx, int height, int width) {
-  int y;
+  Uint64 start = start_perf_timer();
 
   TRACE_LOG("copy-area: %d, %d to %d, %d: %d x %d.\n",
       srcx, srcy, dstx, dsty, width, height);
 
-  if (srcy > dsty) {
-    Uint32 *srcp = (Uint32 *)Surf_Display->pixels
-      + srcy*Surf_Display->pitch/4 + srcx;
-    Uint32 *dstp = (Uint32 *)Surf_Display->pixels
-      + dsty*Surf_Display->pitch/4 + dstx;
+  copy_framebuffer_area(Surf_Display, dsty, dstx, srcy, srcx, height, width);
+  cursor_area_overwritten(dstx, dsty, width, height);
+  if (register_scroll(dsty, dstx, srcy, srcx, height, width) == false)
+    mark_damaged_area(dstx, dsty, width, height);
+  count_overdrawn_area(dstx, dsty, width, height);
 
-    for (y=0; y<height; y++) {
-      memcpy(dstp, srcp, width*4);
-      srcp += Surf_Display->pitch/4;
-      dstp += Surf_Display->pitch/4;
-    }
-  }
-  else {
-    Uint32 *srcp = (Uint32 *)Surf_Display->pixels
-      + (srcy+(height-1))*Surf_Display->pitch/4 + srcx;
-    Uint32 *dstp = (Uint32 *)Surf_Display->pixels
-      + (dsty+(height-1))*Surf_Display->pitch/4 + dstx;
-
-    for (y=0; y<height; y++) {
-      memcpy(dstp, srcp, width*4);
-      srcp -= Surf_Display->pitch/4;
-      dstp -= Surf_Display->pitch/4;
-    }
-  }
+  add_to_perf_counter(COUNTER_COPY_AREA_CALLS, 1);
+  add_to_perf_counter(COUNTER_COPY_AREA_PIXELS, (uint64_t)width * height);
+  stop_perf_timer(TIMER_COPY_AREA, start);
 }
 
 
 void fill_area(int startx, int starty, int xsize, int ysize,
     uint8_t r, uint8_t g, uint8_t b) {
-  int y, x;
-  Uint32 sdl_colour;
-  Uint32 *srcp;
+  Uint64 start = start_perf_timer();
+  int palette_index;
 
   TRACE_LOG("Filling area %d,%d / %d,%d with %d,%d,%d\n",
       startx, starty, xsize, ysize, r, g, b);
 
-  sdl_colour= SDL_MapRGB(Surf_Display->format, r, g, b);
-
-  for (y=0; y<ysize; y++) {
-    srcp = (Uint32 *)Surf_Display->pixels
-      + (starty+y)*Surf_Display->pitch/4 + startx;
-    for (x=0; x<xsize; x++) {
-      *srcp = sdl_colour;
-      srcp++;
+  add_to_perf_counter(COUNTER_FILL_AREA_CALLS, 1);
+  if (is_cursor_fill(startx, starty, xsize, ysize, r, g, b) == true) {
+    stop_perf_timer(TIMER_FILL_AREA, start);
+    return;
+  }
+  cursor_area_overwritten(startx, starty, xsize, ysize);
+
+  mark_damaged_area(startx, starty, xsize, ysize);
+  count_overdrawn_area(startx, starty, xsize, ysize);
+  add_to_perf_counter(COUNTER_FILL_AREA_PIXELS, (uint64_t)xsize * ysize);
+
+  if (Surf_Display->format->BytesPerPixel == 1) {
+    if ((palette_index = map_framebuffer_colour(r, g, b))
+        != FRAMEBUFFER_PALETTE_FULL) {
+      fill_framebuffer_area(
+          Surf_Display, startx, starty, xsize, ysize, palette_index);
+      stop_perf_timer(TIMER_FILL_AREA, start);
+      return;
     }
+    leave_indexed_framebuffer_mode();
   }
+
+  fill_framebuffer_area(
+      Surf_Display, startx, starty, xsize, ysize,
+      SDL_MapRGB(Surf_Display->format, r, g, b));
+  stop_perf_timer(TIMER_FILL_AREA, start);
 }
 
 
-static void set_cursor_visibility(bool UNUSED(visible)) {
+static void set_cursor_visibility(bool visible) {
+  set_cursor_overlay_visibility(visible);
 }
 
 
@@ -1110,6 +2013,20 @@ static z_colour get_default_foreground_colour() {
 }
 
 
+static z_colour get_cursor_colour() {
+  char *colour_name;
+  z_colour result;
+
+  if ( (((colour_name = get_configuration_value("cursor-color")) != NULL)
+        || ((colour_name = get_configuration_value("foreground-color"))
+          != NULL) )
+      && ((result = color_name_to_z_colour(colour_name)) != -1) )
+    return result;
+
+  return get_default_foreground_colour();
+}
+
+
 static z_colour get_default_background_colour() {
   return Z_COLOUR_BLACK;
 }
@@ -1132,12 +2049,20 @@ static int console_output(z_ucs *output) {
 
 
 static int interpreter_thread_function(void *UNUSED(ptr)) {
+  set_event_trace_thread_name("InterpreterThread");
 
   fizmo_start(
       story_stream,
       blorb_stream,
       savegame_to_restore);
 
+  if (running_in_zygote_child == true) {
+    // Without a main thread, there's nothing left to shut down.
+    fflush(stdout);
+    fflush(stderr);
+    _exit(EXIT_SUCCESS);
+  }
+
   sdl_event_evluation_should_stop = true;
 
   return 0;
@@ -1146,7 +2071,7 @@ static int interpreter_thread_function(void *UNUSED(ptr)) {
 
 void preprocess_nonfiltered_resize(int new_x_size, int new_y_size) {
   TRACE_LOG("Starting nonfiltered preprocess_resize.\n");
-  SDL_LockMutex(resize_event_pending_mutex);
+  lock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
 
   resize_event_new_x_size
     = new_x_size < MINIMUM_X_WINDOW_SIZE
@@ -1160,7 +2085,7 @@ void preprocess_nonfiltered_resize(int new_x_size, int new_y_size) {
 
   resize_event_pending = true;
 
-  SDL_UnlockMutex(resize_event_pending_mutex);
+  unlock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
   TRACE_LOG("Finished pnonfiltered reprocess_resize.\n");
 }
 
@@ -1174,9 +2099,10 @@ int sdl_event_filter(void * userdata, SDL_Event *event) {
     // Since this function appears to be running in it's own thread
     // and we're updating the screen, we need to get a lock on the
     // main loop's mutex to avoid collisions:
-    SDL_LockMutex(sdl_main_thread_working_mutex);
+    lock_profiled_mutex(
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
 
-    SDL_LockMutex(resize_event_pending_mutex);
+    lock_profiled_mutex(resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
 
     resize_event_new_x_size
       = event->window.data1 < MINIMUM_X_WINDOW_SIZE
@@ -1189,7 +2115,8 @@ int sdl_event_filter(void * userdata, SDL_Event *event) {
       : event->window.data2;
 
     resize_event_pending = true;
-    SDL_UnlockMutex(resize_event_pending_mutex);
+    unlock_profiled_mutex(
+        resize_event_pending_mutex, LOCK_RESIZE_EVENT_PENDING);
 
     //SDL_LockMutex(filter_mutex);
     filter_is_waiting_for_interpreter_screen_update = true;
@@ -1202,9 +2129,9 @@ int sdl_event_filter(void * userdata, SDL_Event *event) {
 
     TRACE_LOG("Waiting for interpreter_finished_processing_winch_cond ...\n");
     while (interpreter_finished_processing_winch == false) {
-      SDL_CondWait(
-          interpreter_finished_processing_winch_cond,
-          sdl_main_thread_working_mutex);
+      wait_profiled_cond(
+          interpreter_finished_processing_winch_cond, COND_WINCH,
+          sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
     }
 
     process_resize2();
@@ -1214,7 +2141,8 @@ int sdl_event_filter(void * userdata, SDL_Event *event) {
 
     //SDL_UnlockMutex(interpreter_finished_processing_winch_mutex);
 
-    SDL_UnlockMutex(sdl_main_thread_working_mutex);
+    unlock_profiled_mutex(
+        sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
 
     TRACE_LOG("Finished processing filetered resize.\n");
     return 0;
@@ -1256,7 +2184,12 @@ int main(int argc, char *argv[]) {
   int argi = 1;
   int story_filename_parameter_number = -1;
   int blorb_filename_parameter_number = -1;
-  char *input_file;
+  char *input_file = NULL;
+  char *blorb_file = NULL;
+  char *batch_manifest_filename = NULL;
+  int number_of_batch_workers = 0;
+  batch_job *current_batch_job = NULL;
+  batch_job_result batch_result;
   z_colour new_color;
   int int_value, width, height;
   double hidpi_x_scale, hidpi_y_scale;
@@ -1286,10 +2219,13 @@ int main(int argc, char *argv[]) {
 #endif
 
   fizmo_register_screen_pixel_interface(&sdl2_interface);
+#ifndef SOUND_INTERFACE_STRUCT_NAME
+  fizmo_register_sound_interface(&sdl2_sound_interface);
+#endif // SOUND_INTERFACE_STRUCT_NAME
 
-  // Parsing must occur after "fizmo_register_screen_pixel_interface" so
-  // that fizmo knows where to forward "parse_config_parameter" parameters
-  // to.
+  // Parsing must occur after "fizmo_register_screen_pixel_interface" and
+  // "fizmo_register_sound_interface" so that fizmo knows where to forward
+  // "parse_config_parameter" parameters to.
 #ifndef DISABLE_CONFIGFILES
   parse_fizmo_config_files();
 #endif // DISABLE_CONFIGFILES
@@ -1580,6 +2516,64 @@ int main(int argc, char *argv[]) {
 
       argi += 1;
     }
+    else if ( (strcmp(argv[argi], "-bm") == 0)
+        || (strcmp(argv[argi], "--batch-manifest") == 0) ) {
+      if (++argi == argc) {
+        print_startup_syntax();
+        exit(EXIT_FAILURE);
+      }
+      batch_manifest_filename = argv[argi];
+      argi += 1;
+    }
+    else if ( (strcmp(argv[argi], "-bw") == 0)
+        || (strcmp(argv[argi], "--batch-workers") == 0) ) {
+      if (++argi == argc) {
+        print_startup_syntax();
+        exit(EXIT_FAILURE);
+      }
+
+      int_value = atoi(argv[argi]);
+
+      if (int_value < 1) {
+        i18n_translate(
+            fizmo_sdl2_module_name,
+            i18n_sdl2_INVALID_CONFIGURATION_VALUE_P0S_FOR_P1S,
+            argv[argi],
+            argv[argi - 1]);
+
+        streams_latin1_output("\n");
+
+        print_startup_syntax();
+        exit(EXIT_FAILURE);
+      }
+
+      number_of_batch_workers = int_value;
+      argi += 1;
+    }
+    else if ( (strcmp(argv[argi], "-sb") == 0)
+        || (strcmp(argv[argi], "--sound-benchmark") == 0) ) {
+      run_sound_benchmark();
+      exit(EXIT_SUCCESS);
+    }
+    else if ( (strcmp(argv[argi], "-cr") == 0)
+        || (strcmp(argv[argi], "--counters-report") == 0) ) {
+      if (++argi == argc) {
+        print_startup_syntax();
+        exit(EXIT_FAILURE);
+      }
+      set_configuration_value("counters-report", argv[argi]);
+      argi += 1;
+    }
+    else if ( (strcmp(argv[argi], "-zy") == 0)
+        || (strcmp(argv[argi], "--zygote") == 0) ) {
+      zygote_mode = true;
+      headless_session = true;
+      // Neither the audio thread nor image loader threads must be running
+      // while the zygote forks.
+      set_configuration_value("disable-sound", "true");
+      set_number_of_image_loader_threads(0);
+      argi += 1;
+    }
     else if ( (strcmp(argv[argi], "-h") == 0)
         || (strcmp(argv[argi], "--help") == 0) ) {
       print_startup_syntax();
@@ -1605,13 +2599,32 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  if (story_filename_parameter_number == -1) {
+  if (batch_manifest_filename != NULL) {
+    // From here on, we're running inside a batch worker process.
+    current_batch_job
+      = run_batch_jobs(batch_manifest_filename, number_of_batch_workers);
+    input_file = current_batch_job->story_filename;
+    blorb_file = current_batch_job->blorb_filename;
+    scripted_input_filename = current_batch_job->script_filename;
+    headless_session = true;
+    quit_when_input_exhausted = true;
+  }
+  else if (story_filename_parameter_number != -1) {
+    // The user has given some filename or description name on the command line.
+    input_file = argv[story_filename_parameter_number];
+    if (blorb_filename_parameter_number != -1) {
+      blorb_file = argv[blorb_filename_parameter_number];
+    }
+  }
+
+  if (input_file == NULL) {
     // User provided no story file name.
     print_startup_syntax();
   }
   else {
-    // The user has given some filename or description name on the command line.
-    input_file = argv[story_filename_parameter_number];
+    if (mmap_loading_disabled == false) {
+      register_mmap_filesys_interface();
+    }
 
     // Check if parameter is a valid filename.
     story_stream = fsi->openfile(
@@ -1626,7 +2639,43 @@ int main(int argc, char *argv[]) {
       exit(EXIT_FAILURE);
     }
     else {
-      if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
+      if (blorb_file != NULL) {
+        if ((blorb_stream = fsi->openfile(
+                blorb_file, FILETYPE_DATA, FILEACCESS_READ)) == NULL) {
+          i18n_translate(
+              fizmo_sdl2_module_name,
+              i18n_sdl2_COULD_NOT_OPEN_OR_FIND_P0S,
+              blorb_file);
+          streams_latin1_output("\n");
+          exit(EXIT_FAILURE);
+        }
+      }
+
+      // Plain story files without any resources simply yield no entries.
+      // Replaced by the blorb libfizmo actually opens once the story is
+      // linked, see link_interface_to_story().
+      set_blorb_index_file(blorb_file != NULL ? blorb_file : input_file);
+#ifndef SOUND_INTERFACE_STRUCT_NAME
+      set_sdl2_sound_story_file(input_file);
+#endif // SOUND_INTERFACE_STRUCT_NAME
+
+      if (headless_session == true) {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+      }
+
+      start_event_trace();
+      set_event_trace_thread_name("MainThread");
+
+      if (zygote_mode == true) {
+        prepare_zygote_transcript();
+      }
+
+      // Zygotes don't initialize SDL's timer subsystem, since its thread
+      // would not survive the fork. Children poll for read timeouts in
+      // get_next_event instead.
+      if (SDL_Init(zygote_mode == true ? SDL_INIT_VIDEO : SDL_INIT_EVERYTHING)
+          < 0) {
         i18n_translate(
             fizmo_sdl2_module_name,
             i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
@@ -1639,6 +2688,11 @@ int main(int argc, char *argv[]) {
         SDL_SetEventFilter(sdl_event_filter, NULL);
       }
 
+      init_image_cache();
+      window_icon_loaded_event_type = SDL_RegisterEvents(1);
+      start_image_loader();
+      start_band_pool();
+
       SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
 
       //SDL_EnableKeyRepeat(200, 20);
@@ -1656,6 +2710,11 @@ int main(int argc, char *argv[]) {
       update_screen_wait_cond = SDL_CreateCond();
       interpreter_finished_processing_winch_cond = SDL_CreateCond();
 
+      if ( (scripted_input_filename != NULL)
+          && (load_scripted_input(scripted_input_filename) == false) ) {
+        exit(EXIT_FAILURE);
+      }
+
       if ((sdl_window = SDL_CreateWindow("fizmo-sdl2",
           SDL_WINDOWPOS_UNDEFINED,
           SDL_WINDOWPOS_UNDEFINED,
@@ -1671,39 +2730,64 @@ int main(int argc, char *argv[]) {
       }
 
       SDL_GL_GetDrawableSize(sdl_window, &width, &height);
-      hidpi_x_scale = width / unscaled_sdl2_interface_screen_width_in_pixels;
-      hidpi_y_scale = height / unscaled_sdl2_interface_screen_height_in_pixels;
-
-      if (hidpi_x_scale == hidpi_y_scale) {
-        sdl2_device_to_pixel_ratio = hidpi_x_scale;
-
-        scaled_sdl2_interface_screen_width_in_pixels
-          = unscaled_sdl2_interface_screen_width_in_pixels
-          * sdl2_device_to_pixel_ratio;
-
-        scaled_sdl2_interface_screen_height_in_pixels
-          = unscaled_sdl2_interface_screen_height_in_pixels
-          * sdl2_device_to_pixel_ratio;
+      hidpi_x_scale
+        = (double)width / unscaled_sdl2_interface_screen_width_in_pixels;
+      hidpi_y_scale
+        = (double)height / unscaled_sdl2_interface_screen_height_in_pixels;
+
+      sdl2_device_to_pixel_ratio
+        = hidpi_x_scale == hidpi_y_scale
+        ? hidpi_x_scale * render_scale
+        : render_scale;
+
+      scaled_sdl2_interface_screen_width_in_pixels
+        = unscaled_sdl2_interface_screen_width_in_pixels
+        * sdl2_device_to_pixel_ratio;
+
+      scaled_sdl2_interface_screen_height_in_pixels
+        = unscaled_sdl2_interface_screen_height_in_pixels
+        * sdl2_device_to_pixel_ratio;
+
+      if (presentation_backend
+          == presentation_backend_window_surface_option_name) {
+        presenting_via_window_surface = true;
       }
-
-      if ((sdl_renderer = SDL_CreateRenderer(sdl_window, -1, 0)) == NULL) {
-        i18n_translate(
-            fizmo_sdl2_module_name,
-            i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
-            "SDL_CreateRenderer");
-        streams_latin1_output("\n");
-        exit(EXIT_FAILURE);
+      else if (presentation_backend
+          == presentation_backend_renderer_option_name) {
+        if ((sdl_renderer = SDL_CreateRenderer(sdl_window, -1, 0)) == NULL) {
+          i18n_translate(
+              fizmo_sdl2_module_name,
+              i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
+              "SDL_CreateRenderer");
+          streams_latin1_output("\n");
+          exit(EXIT_FAILURE);
+        }
       }
+      else {
+        // SDL's software renderer would only add a texture copy on top of
+        // what the window surface backend does.
+        if ((sdl_renderer = SDL_CreateRenderer(
+                sdl_window, -1, SDL_RENDERER_ACCELERATED)) == NULL) {
+          TRACE_LOG("No accelerated renderer, using the window surface.\n");
+          presenting_via_window_surface = true;
+        }
+      }
+
+      presentation_backend
+        = presenting_via_window_surface == true
+        ? presentation_backend_window_surface_option_name
+        : presentation_backend_renderer_option_name;
+
+      init_damage_tracker(
+          scaled_sdl2_interface_screen_width_in_pixels,
+          scaled_sdl2_interface_screen_height_in_pixels);
+      init_overdraw_map(
+          scaled_sdl2_interface_screen_width_in_pixels,
+          scaled_sdl2_interface_screen_height_in_pixels);
 
-      if ((Surf_Display = SDL_CreateRGBSurface(
-              0,
+      if ((Surf_Display = create_framebuffer_surface(
               scaled_sdl2_interface_screen_width_in_pixels,
-              scaled_sdl2_interface_screen_height_in_pixels,
-              32,
-              0x00FF0000,
-              0x0000FF00,
-              0x000000FF,
-              0xFF000000)) == NULL) {
+              scaled_sdl2_interface_screen_height_in_pixels)) == NULL) {
         i18n_translate(
             fizmo_sdl2_module_name,
             i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
@@ -1712,15 +2796,10 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
       }
 
-      if ((Surf_Backup = SDL_CreateRGBSurface(
-              0,
-              scaled_sdl2_interface_screen_width_in_pixels,
-              scaled_sdl2_interface_screen_height_in_pixels,
-              32,
-              0x00FF0000,
-              0x0000FF00,
-              0x000000FF,
-              0xFF000000)) == NULL) {
+      if ( (presenting_via_window_surface == false)
+          && ((Surf_Backup = create_framebuffer_surface(
+                scaled_sdl2_interface_screen_width_in_pixels,
+                scaled_sdl2_interface_screen_height_in_pixels)) == NULL) ) {
         i18n_translate(
             fizmo_sdl2_module_name,
             i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
@@ -1729,11 +2808,8 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
       }
 
-      if ((sdlTexture = SDL_CreateTexture(sdl_renderer,
-          SDL_PIXELFORMAT_ARGB8888,
-          SDL_TEXTUREACCESS_STREAMING,
-          scaled_sdl2_interface_screen_width_in_pixels,
-          scaled_sdl2_interface_screen_height_in_pixels)) == NULL) {
+      if ( (presenting_via_window_surface == false)
+          && ((sdlTexture = create_framebuffer_texture()) == NULL) ) {
         i18n_translate(
             fizmo_sdl2_module_name,
             i18n_sdl2_FUNCTION_CALL_P0S_ABORTED_DUE_TO_ERROR,
@@ -1742,6 +2818,12 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
       }
 
+      init_scrollback_cache(sdl_renderer);
+      init_smooth_scroll(sdl_renderer, get_render_scale_mode());
+      init_cursor_overlay(sdl_renderer, get_cursor_colour());
+      init_perf_hud(sdl_renderer);
+      init_overdraw_view(sdl_renderer);
+
       timeout_semaphore = SDL_CreateSemaphore(1);
 
 #ifdef SOUND_INTERFACE_STRUCT_NAME
@@ -1757,10 +2839,12 @@ int main(int argc, char *argv[]) {
         if (main_thread_work_complete == false) {
           screen_was_updated = false;
           TRACE_LOG("Found some work to do.\n");
-          SDL_LockMutex(sdl_main_thread_working_mutex);
+          lock_profiled_mutex(
+              sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
 
           if (interpreter_history_was_remeasured == true) {
             interpreter_history_was_remeasured = false;
+            invalidate_scrollback_cache();
             do_update_screen();
           }
 
@@ -1775,7 +2859,7 @@ int main(int argc, char *argv[]) {
 
           /*
           if (main_thread_should_expose_screen == true) {
-            SDL_LockMutex(sdl_backup_surface_mutex);
+            lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
 
             SDL_UpdateTexture(
                 sdlTexture,
@@ -1787,12 +2871,13 @@ int main(int argc, char *argv[]) {
             SDL_RenderCopy(sdl_renderer, sdlTexture, NULL, NULL);
             SDL_RenderPresent(sdl_renderer);
 
-            SDL_UnlockMutex(sdl_backup_surface_mutex);
+            unlock_profiled_mutex(
+                sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
           }
           */
 
           if (main_thread_should_set_title == true) {
-            set_title_and_icon();
+            set_title();
             main_thread_should_set_title = false;
           }
 
@@ -1802,10 +2887,27 @@ int main(int argc, char *argv[]) {
           if (screen_was_updated == true) {
             SDL_CondSignal(update_screen_wait_cond);
           }
-          SDL_UnlockMutex(sdl_main_thread_working_mutex);
+          unlock_profiled_mutex(
+              sdl_main_thread_working_mutex, LOCK_MAIN_THREAD_WORKING);
           TRACE_LOG("Continuing event loop.\n");
         }
 
+        // All of them have to be advanced, even if the first one already
+        // asks for a new frame.
+        if ( (update_cursor_overlay(SDL_GetTicks())
+              | advance_scroll_animation()
+              | update_overdraw_view(SDL_GetTicks())) == true) {
+          lock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+          present_frame();
+          unlock_profiled_mutex(sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+        }
+
+        handle_event_trace_signal();
+
+        if (main_thread_should_park == true) {
+          park_main_thread();
+        }
+
         TRACE_LOG("Starting poll...\n");
         wait_result = SDL_PollEvent(&Event);
         TRACE_LOG("poll's wait_result: %d.\n", wait_result);
@@ -1816,7 +2918,11 @@ int main(int argc, char *argv[]) {
           if (Event.type == SDL_QUIT) {
             push_sdl_event_to_queue(EVENT_WAS_QUIT, 0);
           }
+          else if (Event.type == window_icon_loaded_event_type) {
+            set_icon(Event.user.data1);
+          }
           else if (Event.type == SDL_TEXTINPUT) {
+            show_live_screen();
             ptr = Event.text.text;
             z_ucs_input = utf8_char_to_zucs_char(&ptr);
             TRACE_LOG("z_ucs_input: %d.\n", z_ucs_input);
@@ -1826,6 +2932,13 @@ int main(int argc, char *argv[]) {
             TRACE_LOG("Event was keydown.\n");
             // https://wiki.libsdl.org/SDL_Scancode
 
+            if ( (Event.key.keysym.sym != SDLK_PAGEUP)
+                && (Event.key.keysym.sym != SDLK_PAGEDOWN)
+                && (Event.key.keysym.sym != SDLK_F12)
+                && (Event.key.keysym.sym != SDLK_F11) ) {
+              show_live_screen();
+            }
+
             state = SDL_GetKeyboardState(NULL);
             if ( (state[SDL_SCANCODE_LCTRL])|| (state[SDL_SCANCODE_RCTRL]) ) {
               TRACE_LOG("ctrl\n");
@@ -1866,10 +2979,27 @@ int main(int argc, char *argv[]) {
               push_sdl_event_to_queue(EVENT_WAS_INPUT, Z_UCS_NEWLINE);
             }
             else if (Event.key.keysym.sym == SDLK_PAGEDOWN) {
-              push_sdl_event_to_queue(EVENT_WAS_CODE_PAGE_DOWN, 0);
+              page_down();
             }
             else if (Event.key.keysym.sym == SDLK_PAGEUP) {
-              push_sdl_event_to_queue(EVENT_WAS_CODE_PAGE_UP, 0);
+              page_up();
+            }
+            else if ( (Event.key.keysym.sym == SDLK_F12)
+                && (presenting_via_window_surface == false) ) {
+              toggle_perf_hud();
+              lock_profiled_mutex(
+                  sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+              present_frame();
+              unlock_profiled_mutex(
+                  sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+            }
+            else if ( (Event.key.keysym.sym == SDLK_F11)
+                && (cycle_overdraw_view() == true) ) {
+              lock_profiled_mutex(
+                  sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
+              present_frame();
+              unlock_profiled_mutex(
+                  sdl_backup_surface_mutex, LOCK_BACKUP_SURFACE);
             }
           }
           else if (Event.type == SDL_WINDOWEVENT) {
@@ -1904,14 +3034,30 @@ int main(int argc, char *argv[]) {
       // --- end event evaluation
 
       SDL_WaitThread(sdl_interpreter_thread, &thread_status);
+      stop_event_trace();
+      print_lock_profile();
 
       SDL_DestroySemaphore(timeout_semaphore);
 
+      free_scrollback_cache();
+      free_smooth_scroll();
+      free_cursor_overlay();
+      free_perf_hud();
+      free_overdraw_view();
+      if (sdlTexture != NULL)
+        SDL_DestroyTexture(sdlTexture);
+      if (sdl_renderer != NULL)
+        SDL_DestroyRenderer(sdl_renderer);
       SDL_DestroyWindow(sdl_window);
-      SDL_DestroyRenderer(sdl_renderer);
-      SDL_FreeSurface(Surf_Display);
-      SDL_FreeSurface(Surf_Backup);
-      SDL_DestroyTexture(sdlTexture);
+      free_framebuffer_surface(Surf_Display);
+      free_framebuffer_surface(Surf_Backup);
+      free_framebuffer_palette();
+      free_damage_tracker();
+
+      stop_image_loader();
+      stop_band_pool();
+      release_pending_window_icons();
+      free_image_cache();
 
       SDL_DestroyCond(interpreter_finished_processing_winch_cond);
       SDL_DestroyCond(sdl_main_thread_working_cond);
@@ -1923,9 +3069,18 @@ int main(int argc, char *argv[]) {
       SDL_DestroyMutex(sdl_event_queue_mutex);
 
       SDL_Quit();
+
+      if (current_batch_job != NULL) {
+        batch_result.completed = quit_on_exhausted_input == false;
+        batch_result.turns = number_of_input_lines_processed;
+        batch_result.frames = number_of_frames_rendered;
+        report_batch_job_result(&batch_result);
+      }
     }
   }
 
+  write_counters_report();
+
 #ifdef ENABLE_TRACING
   TRACE_LOG("Turning off trace.\n\n");
   turn_off_trace();
@@ -0,0 +1,541 @@
+/* framebuffer.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/unused.h>
+
+#include "framebuffer.h"
+#include "band_pool.h"
+
+#define PALETTE_SIZE 256
+// Open addressing with at most half of the slots in use.
+#define COLOUR_HASH_SIZE 512
+#define NO_COLOUR 0xffffffff
+
+// Rows start on cache line boundaries. Pitches which are a multiple of
+// FRAMEBUFFER_CACHE_ALIASING_STRIDE would map vertically adjacent pixels
+// onto the same cache sets, so these get another cache line of padding.
+#define FRAMEBUFFER_ROW_ALIGNMENT 64
+#define FRAMEBUFFER_CACHE_ALIASING_STRIDE 4096
+#define FRAMEBUFFER_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+struct framebuffer_memory {
+  void *data;
+  size_t size;
+  bool is_mapped;
+};
+
+struct fill_job {
+  uint8_t *first_row;
+  int pitch;
+  int width;
+  int bytes_per_pixel;
+  uint32_t value;
+};
+
+// Overlapping copies are run in two passes: The first one saves the rows
+// each band reads but the neighbouring band overwrites, the second one
+// copies all rows, taking these from the saved ones.
+struct copy_job {
+  uint8_t *src;
+  uint8_t *dst;
+  int pitch;
+  size_t row_bytes;
+  int nof_rows;
+  int nof_bands;
+  int distance;
+  bool downwards;
+  uint8_t *saved_rows;
+};
+
+struct upload_job {
+  uint8_t *src;
+  int src_pitch;
+  uint8_t *dest;
+  int dest_pitch;
+  int width;
+  int bytes_per_pixel;
+};
+
+static bool indexed_framebuffer_enabled = false;
+static SDL_Palette *framebuffer_palette = NULL;
+static int nof_palette_colours = 0;
+static uint32_t palette_argb[PALETTE_SIZE];
+static uint32_t colour_hash_keys[COLOUR_HASH_SIZE];
+static uint8_t colour_hash_indexes[COLOUR_HASH_SIZE];
+static uint32_t last_mapped_colour = NO_COLOUR;
+static int last_mapped_index;
+
+
+void set_indexed_framebuffer_enabled(bool enabled) {
+  indexed_framebuffer_enabled = enabled;
+}
+
+
+bool is_indexed_framebuffer_enabled() {
+  return indexed_framebuffer_enabled;
+}
+
+
+static void init_framebuffer_palette() {
+  int i;
+
+  framebuffer_palette = SDL_AllocPalette(PALETTE_SIZE);
+  nof_palette_colours = 0;
+  last_mapped_colour = NO_COLOUR;
+  for (i=0; i<COLOUR_HASH_SIZE; i++)
+    colour_hash_keys[i] = NO_COLOUR;
+}
+
+
+static struct framebuffer_memory *allocate_framebuffer_memory(size_t size) {
+  struct framebuffer_memory *memory;
+  void *data = MAP_FAILED;
+
+  memory = fizmo_malloc(sizeof(struct framebuffer_memory));
+
+  // Large framebuffers try explicit huge pages first, then transparent
+  // huge pages, so that full-frame operations cause fewer TLB misses.
+#ifdef MAP_HUGETLB
+  if (size >= FRAMEBUFFER_HUGE_PAGE_SIZE) {
+    memory->size
+      = (size + FRAMEBUFFER_HUGE_PAGE_SIZE - 1)
+      & ~((size_t)FRAMEBUFFER_HUGE_PAGE_SIZE - 1);
+    data = mmap(NULL, memory->size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif // MAP_HUGETLB
+
+  if (data == MAP_FAILED) {
+    memory->size = size;
+    data = mmap(NULL, memory->size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+    if ( (data != MAP_FAILED) && (size >= FRAMEBUFFER_HUGE_PAGE_SIZE) )
+      madvise(data, memory->size, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+  }
+
+  if (data != MAP_FAILED) {
+    memory->data = data;
+    memory->is_mapped = true;
+  }
+  else if (posix_memalign(&memory->data, FRAMEBUFFER_ROW_ALIGNMENT, size)
+      == 0) {
+    memset(memory->data, 0, size);
+    memory->is_mapped = false;
+  }
+  else {
+    free(memory);
+    return NULL;
+  }
+
+  return memory;
+}
+
+
+static void free_framebuffer_memory(struct framebuffer_memory *memory) {
+  if (memory->is_mapped == true)
+    munmap(memory->data, memory->size);
+  else
+    free(memory->data);
+  free(memory);
+}
+
+
+SDL_Surface *create_framebuffer_surface(int width, int height) {
+  struct framebuffer_memory *memory;
+  SDL_Surface *result;
+  int bytes_per_pixel, pitch;
+
+  bytes_per_pixel = indexed_framebuffer_enabled == true ? 1 : 4;
+
+  pitch
+    = (width * bytes_per_pixel + FRAMEBUFFER_ROW_ALIGNMENT - 1)
+    & ~(FRAMEBUFFER_ROW_ALIGNMENT - 1);
+  if (pitch % FRAMEBUFFER_CACHE_ALIASING_STRIDE == 0)
+    pitch += FRAMEBUFFER_ROW_ALIGNMENT;
+
+  if ((memory = allocate_framebuffer_memory((size_t)pitch * height)) == NULL)
+    return NULL;
+
+  if (indexed_framebuffer_enabled == false) {
+    result = SDL_CreateRGBSurfaceFrom(
+        memory->data,
+        width,
+        height,
+        32,
+        pitch,
+        0x00FF0000,
+        0x0000FF00,
+        0x000000FF,
+        0xFF000000);
+  }
+  else {
+    if (framebuffer_palette == NULL)
+      init_framebuffer_palette();
+
+    if ((result = SDL_CreateRGBSurfaceWithFormatFrom(
+            memory->data, width, height, 8, pitch, SDL_PIXELFORMAT_INDEX8))
+        != NULL) {
+      // All framebuffers share the same palette, so that indexed pixels
+      // may be copied between them as they are.
+      SDL_SetSurfacePalette(result, framebuffer_palette);
+    }
+  }
+
+  if (result == NULL) {
+    free_framebuffer_memory(memory);
+    return NULL;
+  }
+
+  // All framebuffer pixels are opaque, so blits out of it may be plain
+  // copies instead of going through SDL's alpha blending.
+  SDL_SetSurfaceBlendMode(result, SDL_BLENDMODE_NONE);
+
+  TRACE_LOG("Created %dx%d framebuffer, pitch %d, %s.\n",
+      width, height, pitch,
+      memory->is_mapped == true ? "mapped" : "heap");
+
+  result->userdata = memory;
+
+  return result;
+}
+
+
+void free_framebuffer_surface(SDL_Surface *surface) {
+  struct framebuffer_memory *memory;
+
+  if (surface == NULL)
+    return;
+
+  // SDL never frees pixels of surfaces created from existing memory.
+  memory = surface->userdata;
+  SDL_FreeSurface(surface);
+  free_framebuffer_memory(memory);
+}
+
+
+int map_framebuffer_colour(uint8_t r, uint8_t g, uint8_t b) {
+  uint32_t colour = ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  unsigned int slot;
+  SDL_Color sdl_colour;
+
+  if (colour == last_mapped_colour)
+    return last_mapped_index;
+
+  slot = (colour * 2654435761U) >> 23;
+  while (colour_hash_keys[slot] != NO_COLOUR) {
+    if (colour_hash_keys[slot] == colour) {
+      last_mapped_colour = colour;
+      last_mapped_index = colour_hash_indexes[slot];
+      return last_mapped_index;
+    }
+    slot = (slot + 1) & (COLOUR_HASH_SIZE - 1);
+  }
+
+  if (nof_palette_colours == PALETTE_SIZE)
+    return FRAMEBUFFER_PALETTE_FULL;
+
+  sdl_colour.r = r;
+  sdl_colour.g = g;
+  sdl_colour.b = b;
+  sdl_colour.a = 0xff;
+  SDL_SetPaletteColors(framebuffer_palette, &sdl_colour,
+      nof_palette_colours, 1);
+  palette_argb[nof_palette_colours] = 0xff000000 | colour;
+
+  colour_hash_keys[slot] = colour;
+  colour_hash_indexes[slot] = nof_palette_colours;
+  last_mapped_colour = colour;
+  last_mapped_index = nof_palette_colours;
+
+  TRACE_LOG("Added colour %06x as palette index %d.\n",
+      colour, nof_palette_colours);
+
+  return nof_palette_colours++;
+}
+
+
+SDL_Surface *convert_framebuffer_to_truecolour(SDL_Surface *surface) {
+  SDL_Surface *result;
+
+  TRACE_LOG("Palette exhausted, switching to 32-bit framebuffers.\n");
+
+  indexed_framebuffer_enabled = false;
+
+  if ((result = create_framebuffer_surface(surface->w, surface->h)) == NULL)
+    return NULL;
+
+  SDL_BlitSurface(surface, NULL, result, NULL);
+  free_framebuffer_surface(surface);
+
+  return result;
+}
+
+
+static void fill_band(int first_row, int end_row, int UNUSED(band_index),
+    void *data) {
+  struct fill_job *job = data;
+  uint32_t *dest;
+  int y, x;
+
+  for (y=first_row; y<end_row; y++) {
+    if (job->bytes_per_pixel == 1) {
+      memset(job->first_row + y*job->pitch, job->value, job->width);
+    }
+    else {
+      dest = (uint32_t*)(job->first_row + y*job->pitch);
+      for (x=0; x<job->width; x++)
+        dest[x] = job->value;
+    }
+  }
+}
+
+
+void fill_framebuffer_area(SDL_Surface *surface, int x, int y, int width,
+    int height, uint32_t value) {
+  struct fill_job job;
+  int bytes_per_pixel = surface->format->BytesPerPixel;
+
+  job.first_row
+    = (uint8_t*)surface->pixels + y*surface->pitch + x*bytes_per_pixel;
+  job.pitch = surface->pitch;
+  job.width = width;
+  job.bytes_per_pixel = bytes_per_pixel;
+  job.value = value;
+
+  run_in_bands(
+      height,
+      plan_bands(height, (size_t)width * bytes_per_pixel, 0),
+      &fill_band,
+      &job);
+}
+
+
+static uint8_t *get_saved_row(struct copy_job *job, int band_index,
+    int row_in_band) {
+  return job->saved_rows
+    + ((size_t)band_index * job->distance + row_in_band) * job->row_bytes;
+}
+
+
+static void save_copy_band_rows(int first_row, int end_row, int band_index,
+    void *data) {
+  struct copy_job *job = data;
+  int i;
+
+  if (job->downwards == false) {
+    // The last rows read are overwritten by the following band.
+    if (end_row == job->nof_rows)
+      return;
+    for (i=0; i<job->distance; i++)
+      memcpy(get_saved_row(job, band_index, i),
+          job->src + (end_row - job->distance + i) * job->pitch,
+          job->row_bytes);
+  }
+  else {
+    // The first rows read are overwritten by the preceding band.
+    if (first_row == 0)
+      return;
+    for (i=0; i<job->distance; i++)
+      memcpy(get_saved_row(job, band_index, i),
+          job->src + (first_row + i) * job->pitch,
+          job->row_bytes);
+  }
+}
+
+
+static void copy_band(int first_row, int end_row, int band_index,
+    void *data) {
+  struct copy_job *job = data;
+  int direct_first_row = first_row, direct_end_row = end_row, i;
+
+  if (job->saved_rows != NULL) {
+    if ( (job->downwards == false) && (end_row != job->nof_rows) )
+      direct_end_row = end_row - job->distance;
+    else if ( (job->downwards == true) && (first_row != 0) )
+      direct_first_row = first_row + job->distance;
+  }
+
+  if (job->downwards == false) {
+    for (i=direct_first_row; i<direct_end_row; i++)
+      memmove(job->dst + i*job->pitch, job->src + i*job->pitch,
+          job->row_bytes);
+    for (i=direct_end_row; i<end_row; i++)
+      memcpy(job->dst + i*job->pitch,
+          get_saved_row(job, band_index, i - direct_end_row),
+          job->row_bytes);
+  }
+  else {
+    for (i=direct_end_row-1; i>=direct_first_row; i--)
+      memmove(job->dst + i*job->pitch, job->src + i*job->pitch,
+          job->row_bytes);
+    for (i=first_row; i<direct_first_row; i++)
+      memcpy(job->dst + i*job->pitch,
+          get_saved_row(job, band_index, i - first_row),
+          job->row_bytes);
+  }
+}
+
+
+void copy_framebuffer_area(SDL_Surface *surface, int dsty, int dstx,
+    int srcy, int srcx, int height, int width) {
+  struct copy_job job;
+  int bytes_per_pixel = surface->format->BytesPerPixel;
+
+  job.src
+    = (uint8_t*)surface->pixels + srcy*surface->pitch + srcx*bytes_per_pixel;
+  job.dst
+    = (uint8_t*)surface->pixels + dsty*surface->pitch + dstx*bytes_per_pixel;
+  job.pitch = surface->pitch;
+  job.row_bytes = (size_t)width * bytes_per_pixel;
+  job.nof_rows = height;
+  job.downwards = dsty > srcy;
+  job.distance = job.downwards == true ? dsty - srcy : srcy - dsty;
+  job.saved_rows = NULL;
+
+  // Each band has to be at least as high as the copy distance, so that
+  // only the directly neighbouring band interferes with it.
+  job.nof_bands = plan_bands(height, job.row_bytes, job.distance);
+
+  if ( (job.nof_bands > 1)
+      && (job.distance > 0)
+      && (job.distance < height) ) {
+    job.saved_rows
+      = fizmo_malloc((size_t)job.nof_bands * job.distance * job.row_bytes);
+    run_in_bands(height, job.nof_bands, &save_copy_band_rows, &job);
+  }
+
+  run_in_bands(height, job.nof_bands, &copy_band, &job);
+
+  free(job.saved_rows);
+}
+
+
+static void upload_band(int first_row, int end_row, int UNUSED(band_index),
+    void *data) {
+  struct upload_job *job = data;
+  uint8_t *src_row;
+  uint32_t *dest_row;
+  int x, y;
+
+  for (y=first_row; y<end_row; y++) {
+    src_row = job->src + y*job->src_pitch;
+    dest_row = (uint32_t*)(job->dest + y*job->dest_pitch);
+    if (job->bytes_per_pixel == 4) {
+      memcpy(dest_row, src_row, job->width * 4);
+    }
+    else {
+      for (x=0; x<job->width; x++)
+        dest_row[x] = palette_argb[src_row[x]];
+    }
+  }
+}
+
+
+void upload_framebuffer_rect(SDL_Texture *texture, int texture_y,
+    SDL_Surface *surface, const SDL_Rect *rect) {
+  struct upload_job job;
+  SDL_Rect texture_rect;
+  uint8_t *src;
+  void *texture_pixels;
+  int texture_pitch, nof_bands;
+
+  texture_rect.x = 0;
+  texture_rect.y = texture_y;
+  texture_rect.w = rect->w;
+  texture_rect.h = rect->h;
+
+  src = (uint8_t*)surface->pixels
+    + rect->y * surface->pitch
+    + rect->x * surface->format->BytesPerPixel;
+
+  nof_bands = plan_bands(rect->h, (size_t)rect->w * 4, 0);
+
+  // Unsplit 32-bit uploads are left to SDL, which may avoid a copy.
+  if ( (surface->format->BytesPerPixel == 4) && (nof_bands == 1) ) {
+    SDL_UpdateTexture(texture, &texture_rect, src, surface->pitch);
+    return;
+  }
+
+  if (SDL_LockTexture(texture, &texture_rect, &texture_pixels, &texture_pitch)
+      != 0)
+    return;
+
+  job.src = src;
+  job.src_pitch = surface->pitch;
+  job.dest = texture_pixels;
+  job.dest_pitch = texture_pitch;
+  job.width = rect->w;
+  job.bytes_per_pixel = surface->format->BytesPerPixel;
+
+  run_in_bands(rect->h, nof_bands, &upload_band, &job);
+
+  SDL_UnlockTexture(texture);
+}
+
+
+void upload_framebuffer_rows(SDL_Texture *texture, SDL_Surface *surface,
+    int first_row, int nof_rows) {
+  SDL_Rect rows;
+
+  rows.x = 0;
+  rows.y = first_row;
+  rows.w = surface->w;
+  rows.h = nof_rows;
+
+  upload_framebuffer_rect(texture, first_row, surface, &rows);
+}
+
+
+void upload_framebuffer(SDL_Texture *texture, SDL_Surface *surface) {
+  upload_framebuffer_rows(texture, surface, 0, surface->h);
+}
+
+
+void free_framebuffer_palette() {
+  if (framebuffer_palette != NULL) {
+    SDL_FreePalette(framebuffer_palette);
+    framebuffer_palette = NULL;
+  }
+}
+
@@ -0,0 +1,96 @@
+/* framebuffer.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Allocation of the surfaces libpixelif draws into, and their upload to
+ * the streaming texture. Framebuffers are either 32-bit ARGB8888 or, in
+ * indexed mode, 8-bit with a palette that is filled as colours are used.
+ * Since SDL's renderers don't support paletted textures, indexed pixels
+ * are expanded to ARGB8888 when the texture is updated.
+ *
+ * The pixel memory is allocated here instead of by SDL: Rows are 64-byte
+ * aligned and padded to avoid cache set aliasing, and large framebuffers
+ * are backed by huge pages where the system provides them.
+ *
+ */
+
+
+#ifndef framebuffer_h_INCLUDED
+#define framebuffer_h_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#define FRAMEBUFFER_PALETTE_FULL -1
+
+void set_indexed_framebuffer_enabled(bool enabled);
+bool is_indexed_framebuffer_enabled();
+
+// Creates a surface in the current framebuffer format, which is indexed
+// as long as indexed mode is enabled and the palette hasn't overflown.
+// Such surfaces have to be freed using free_framebuffer_surface.
+SDL_Surface *create_framebuffer_surface(int width, int height);
+void free_framebuffer_surface(SDL_Surface *surface);
+
+// Returns the palette index for the given colour, adding it to the
+// palette if necessary, or FRAMEBUFFER_PALETTE_FULL. This is only to be
+// called by the interpreter thread.
+int map_framebuffer_colour(uint8_t r, uint8_t g, uint8_t b);
+
+// Converts the given indexed surface to ARGB8888 and permanently leaves
+// indexed mode. Returns the new surface, the old one is freed.
+SDL_Surface *convert_framebuffer_to_truecolour(SDL_Surface *surface);
+
+// Raster operations, which are split into bands run on the band pool
+// for large areas. "value" is a palette index for indexed surfaces.
+void fill_framebuffer_area(SDL_Surface *surface, int x, int y, int width,
+    int height, uint32_t value);
+void copy_framebuffer_area(SDL_Surface *surface, int dsty, int dstx,
+    int srcy, int srcx, int height, int width);
+
+// Copies the surface's pixels into the ARGB8888 streaming texture. The
+// rows variant leaves the texture's other rows as they are.
+void upload_framebuffer(SDL_Texture *texture, SDL_Surface *surface);
+void upload_framebuffer_rows(SDL_Texture *texture, SDL_Surface *surface,
+    int first_row, int nof_rows);
+
+// Copies the given part of the surface to the texture's left edge,
+// starting at row "texture_y".
+void upload_framebuffer_rect(SDL_Texture *texture, int texture_y,
+    SDL_Surface *surface, const SDL_Rect *rect);
+
+void free_framebuffer_palette();
+
+#endif // framebuffer_h_INCLUDED
+
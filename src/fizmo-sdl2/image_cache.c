@@ -0,0 +1,298 @@
+/* image_cache.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/filesys.h>
+#include <drilbo/drilbo.h>
+#include <drilbo/drilbo-jpeg.h>
+#include <drilbo/drilbo-png.h>
+
+#include "blorb_index.h"
+#include "image_cache.h"
+#include "pixel_conversion.h"
+
+struct image_cache_entry {
+  cached_image image;
+  // The size which was asked for, where 0x0 means the original size.
+  int requested_width;
+  int requested_height;
+  size_t size;
+  int ref_count;
+  bool evicted;
+  struct image_cache_entry *prev;
+  struct image_cache_entry *next;
+};
+
+// The list is ordered from most to least recently used.
+static struct image_cache_entry *most_recently_used = NULL;
+static struct image_cache_entry *least_recently_used = NULL;
+static size_t image_cache_budget = DEFAULT_IMAGE_CACHE_BUDGET;
+static size_t image_cache_size = 0;
+static SDL_mutex *image_cache_mutex = NULL;
+
+
+static void unlink_entry(struct image_cache_entry *entry) {
+  if (entry->prev != NULL)
+    entry->prev->next = entry->next;
+  else
+    most_recently_used = entry->next;
+
+  if (entry->next != NULL)
+    entry->next->prev = entry->prev;
+  else
+    least_recently_used = entry->prev;
+
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+
+static void link_entry_as_most_recent(struct image_cache_entry *entry) {
+  entry->prev = NULL;
+  entry->next = most_recently_used;
+  if (most_recently_used != NULL)
+    most_recently_used->prev = entry;
+  most_recently_used = entry;
+  if (least_recently_used == NULL)
+    least_recently_used = entry;
+}
+
+
+static void free_entry(struct image_cache_entry *entry) {
+  free(entry->image.pixels);
+  free(entry);
+}
+
+
+// Drops entries from the tail of the list until the cache fits into its
+// budget. Entries which are still in use are unlinked but only freed once
+// they are released.
+static void evict_entries() {
+  struct image_cache_entry *entry;
+
+  while ( (image_cache_size > image_cache_budget)
+      && ((entry = least_recently_used) != NULL) ) {
+    TRACE_LOG("Evicting image %d (%dx%d) from cache.\n",
+        entry->image.resource_number, entry->image.width,
+        entry->image.height);
+    unlink_entry(entry);
+    image_cache_size -= entry->size;
+    if (entry->ref_count == 0)
+      free_entry(entry);
+    else
+      entry->evicted = true;
+  }
+}
+
+
+// Pictures are always decoded from a file handle of our own -- which is
+// a mapping of the blorb file unless mmap is disabled -- since the
+// story's blorb stream is used by the interpreter and drilbo without
+// any locking, and decoding may run on any thread.
+static z_image *decode_blorb_image(int resource_number) {
+  blorb_index_entry *entry;
+  z_image *image = NULL;
+  char *blorb_filename;
+  z_file *in;
+
+  if ( ((entry = get_blorb_index_entry(
+            BLORB_INDEX_USAGE_PICTURE, resource_number)) == NULL)
+      || ((blorb_filename = get_blorb_index_filename()) == NULL)
+      || ((in = fsi->openfile(
+            blorb_filename, FILETYPE_DATA, FILEACCESS_READ)) == NULL) )
+    return NULL;
+
+  if (fsi->setfilepos(in, entry->offset, SEEK_SET) == 0) {
+    if (entry->chunk_type == BLORB_INDEX_ID('P', 'N', 'G', ' '))
+      image = read_zimage_from_png(in);
+    else if (entry->chunk_type == BLORB_INDEX_ID('J', 'P', 'E', 'G'))
+      image = read_zimage_from_jpeg(in);
+  }
+  fsi->closefile(in);
+
+  return image;
+}
+
+
+static struct image_cache_entry *create_entry(int resource_number,
+    int width, int height, uint32_t pixel_format) {
+  struct image_cache_entry *entry;
+  z_image *image, *scaled_image;
+  uint32_t *pixels;
+
+  if ((image = decode_blorb_image(resource_number)) == NULL)
+    return NULL;
+
+  if ( ( (width != 0) || (height != 0) )
+      && ( (width != image->width) || (height != image->height) ) ) {
+    scaled_image = scale_zimage(image, width, height);
+    free_zimage(image);
+    if ((image = scaled_image) == NULL)
+      return NULL;
+  }
+
+  pixels = convert_zimage_to_argb8888(image);
+
+  if (pixels == NULL) {
+    free_zimage(image);
+    return NULL;
+  }
+
+  entry = fizmo_malloc(sizeof(struct image_cache_entry));
+  entry->image.resource_number = resource_number;
+  entry->image.width = image->width;
+  entry->image.height = image->height;
+  entry->image.pixel_format = pixel_format;
+  entry->image.pixels = pixels;
+  entry->requested_width = width;
+  entry->requested_height = height;
+  entry->size
+    = sizeof(struct image_cache_entry)
+    + sizeof(uint32_t) * image->width * image->height;
+  entry->ref_count = 0;
+  entry->evicted = false;
+  entry->prev = NULL;
+  entry->next = NULL;
+
+  free_zimage(image);
+
+  return entry;
+}
+
+
+void init_image_cache() {
+  if (image_cache_mutex == NULL)
+    image_cache_mutex = SDL_CreateMutex();
+}
+
+
+void free_image_cache() {
+  struct image_cache_entry *entry;
+
+  if (image_cache_mutex == NULL)
+    return;
+
+  SDL_LockMutex(image_cache_mutex);
+  while ((entry = most_recently_used) != NULL) {
+    unlink_entry(entry);
+    if (entry->ref_count == 0)
+      free_entry(entry);
+    else
+      entry->evicted = true;
+  }
+  image_cache_size = 0;
+  SDL_UnlockMutex(image_cache_mutex);
+}
+
+
+void set_image_cache_budget(size_t budget_in_bytes) {
+  image_cache_budget = budget_in_bytes;
+
+  if (image_cache_mutex != NULL) {
+    SDL_LockMutex(image_cache_mutex);
+    evict_entries();
+    SDL_UnlockMutex(image_cache_mutex);
+  }
+}
+
+
+size_t get_image_cache_budget() {
+  return image_cache_budget;
+}
+
+
+cached_image *get_cached_blorb_image(int resource_number, int width,
+    int height, uint32_t pixel_format) {
+  struct image_cache_entry *entry;
+
+  if ( (pixel_format != SDL_PIXELFORMAT_ARGB8888)
+      || (width < 0) || (height < 0) )
+    return NULL;
+
+  SDL_LockMutex(image_cache_mutex);
+
+  for (entry = most_recently_used; entry != NULL; entry = entry->next) {
+    if ( (entry->image.resource_number == resource_number)
+        && (entry->image.pixel_format == pixel_format)
+        && (entry->requested_width == width)
+        && (entry->requested_height == height) ) {
+      TRACE_LOG("Image %d (%dx%d) found in cache.\n",
+          resource_number, width, height);
+      unlink_entry(entry);
+      link_entry_as_most_recent(entry);
+      entry->ref_count++;
+      SDL_UnlockMutex(image_cache_mutex);
+      return &entry->image;
+    }
+  }
+
+  // Decoding and scaling is done without holding the lock. In case
+  // another thread has created the same entry in the meantime, both
+  // are kept and the older one ages out.
+  SDL_UnlockMutex(image_cache_mutex);
+
+  if ((entry = create_entry(resource_number, width, height, pixel_format))
+      == NULL)
+    return NULL;
+
+  SDL_LockMutex(image_cache_mutex);
+  entry->ref_count = 1;
+  link_entry_as_most_recent(entry);
+  image_cache_size += entry->size;
+  evict_entries();
+  SDL_UnlockMutex(image_cache_mutex);
+
+  return &entry->image;
+}
+
+
+void release_cached_image(cached_image *image) {
+  // "image" is the first member of the entry.
+  struct image_cache_entry *entry = (struct image_cache_entry*)image;
+
+  if (image == NULL)
+    return;
+
+  SDL_LockMutex(image_cache_mutex);
+  entry->ref_count--;
+  if ( (entry->ref_count == 0) && (entry->evicted == true) )
+    free_entry(entry);
+  SDL_UnlockMutex(image_cache_mutex);
+}
+
@@ -0,0 +1,74 @@
+/* image_cache.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A cache for decoded and scaled blorb pictures, stored ready-to-blit
+ * in the requested pixel format. Entries are keyed by resource number,
+ * size and pixel format and are evicted in least-recently-used order
+ * once the cache's memory budget is exceeded.
+ *
+ */
+
+
+#ifndef image_cache_h_INCLUDED
+#define image_cache_h_INCLUDED
+
+#include <tools/types.h>
+
+#define DEFAULT_IMAGE_CACHE_BUDGET (32 * 1024 * 1024)
+
+typedef struct {
+  int resource_number;
+  int width;
+  int height;
+  uint32_t pixel_format;
+  uint32_t *pixels;
+} cached_image;
+
+// Has to be called before the cache is used from any thread.
+void init_image_cache();
+void free_image_cache();
+
+void set_image_cache_budget(size_t budget_in_bytes);
+size_t get_image_cache_budget();
+
+// Returns the given picture scaled to "width" x "height" -- or in its
+// original size in case both are zero -- or NULL if the picture is not
+// available. Only SDL_PIXELFORMAT_ARGB8888 is supported at the moment.
+// Each returned image has to be released using release_cached_image.
+cached_image *get_cached_blorb_image(int resource_number, int width,
+    int height, uint32_t pixel_format);
+void release_cached_image(cached_image *image);
+
+#endif // image_cache_h_INCLUDED
+
@@ -0,0 +1,210 @@
+/* image_loader.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/unused.h>
+
+#include "image_loader.h"
+
+#define MAX_NUMBER_OF_IMAGE_LOADER_THREADS 16
+
+struct image_load_request {
+  int resource_number;
+  int width;
+  int height;
+  uint32_t pixel_format;
+  image_loader_callback callback;
+  void *callback_data;
+  struct image_load_request *next;
+};
+
+static int number_of_image_loader_threads
+  = DEFAULT_NUMBER_OF_IMAGE_LOADER_THREADS;
+static SDL_Thread *image_loader_threads[MAX_NUMBER_OF_IMAGE_LOADER_THREADS];
+static int number_of_running_threads = 0;
+static SDL_mutex *image_loader_mutex = NULL;
+static SDL_cond *image_loader_cond = NULL;
+static struct image_load_request *first_request = NULL;
+static struct image_load_request *last_request = NULL;
+static bool image_loader_should_stop = false;
+
+
+static void process_request(struct image_load_request *request) {
+  cached_image *image;
+
+  TRACE_LOG("Loading image %d (%dx%d).\n",
+      request->resource_number, request->width, request->height);
+
+  image = get_cached_blorb_image(
+      request->resource_number,
+      request->width,
+      request->height,
+      request->pixel_format);
+
+  if (request->callback != NULL)
+    request->callback(image, request->callback_data);
+  else
+    release_cached_image(image);
+}
+
+
+static int image_loader_thread_function(void *UNUSED(data)) {
+  struct image_load_request *request;
+
+  SDL_LockMutex(image_loader_mutex);
+
+  for (;;) {
+    while ( (first_request == NULL) && (image_loader_should_stop == false) )
+      SDL_CondWait(image_loader_cond, image_loader_mutex);
+
+    if (image_loader_should_stop == true)
+      break;
+
+    request = first_request;
+    if ((first_request = request->next) == NULL)
+      last_request = NULL;
+
+    SDL_UnlockMutex(image_loader_mutex);
+    process_request(request);
+    free(request);
+    SDL_LockMutex(image_loader_mutex);
+  }
+
+  SDL_UnlockMutex(image_loader_mutex);
+
+  return 0;
+}
+
+
+void set_number_of_image_loader_threads(int nof_threads) {
+  if (nof_threads < 0)
+    nof_threads = 0;
+  else if (nof_threads > MAX_NUMBER_OF_IMAGE_LOADER_THREADS)
+    nof_threads = MAX_NUMBER_OF_IMAGE_LOADER_THREADS;
+
+  number_of_image_loader_threads = nof_threads;
+}
+
+
+int get_number_of_image_loader_threads() {
+  return number_of_image_loader_threads;
+}
+
+
+void start_image_loader() {
+  char thread_name[32];
+  int i;
+
+  if (number_of_running_threads > 0)
+    return;
+
+  image_loader_mutex = SDL_CreateMutex();
+  image_loader_cond = SDL_CreateCond();
+  image_loader_should_stop = false;
+
+  for (i=0; i<number_of_image_loader_threads; i++) {
+    snprintf(thread_name, sizeof(thread_name), "ImageLoaderThread%d", i);
+    if ((image_loader_threads[i] = SDL_CreateThread(
+            image_loader_thread_function, thread_name, NULL)) == NULL)
+      break;
+    number_of_running_threads++;
+  }
+
+  TRACE_LOG("Started %d image loader threads.\n", number_of_running_threads);
+}
+
+
+void stop_image_loader() {
+  struct image_load_request *request;
+  int i;
+
+  if (image_loader_mutex == NULL)
+    return;
+
+  SDL_LockMutex(image_loader_mutex);
+  image_loader_should_stop = true;
+  while ((request = first_request) != NULL) {
+    first_request = request->next;
+    free(request);
+  }
+  last_request = NULL;
+  SDL_CondBroadcast(image_loader_cond);
+  SDL_UnlockMutex(image_loader_mutex);
+
+  for (i=0; i<number_of_running_threads; i++)
+    SDL_WaitThread(image_loader_threads[i], NULL);
+  number_of_running_threads = 0;
+
+  SDL_DestroyCond(image_loader_cond);
+  SDL_DestroyMutex(image_loader_mutex);
+  image_loader_cond = NULL;
+  image_loader_mutex = NULL;
+}
+
+
+void load_blorb_image_async(int resource_number, int width, int height,
+    uint32_t pixel_format, image_loader_callback callback,
+    void *callback_data) {
+  struct image_load_request *request;
+
+  request = fizmo_malloc(sizeof(struct image_load_request));
+  request->resource_number = resource_number;
+  request->width = width;
+  request->height = height;
+  request->pixel_format = pixel_format;
+  request->callback = callback;
+  request->callback_data = callback_data;
+  request->next = NULL;
+
+  if (number_of_running_threads == 0) {
+    process_request(request);
+    free(request);
+    return;
+  }
+
+  SDL_LockMutex(image_loader_mutex);
+  if (last_request != NULL)
+    last_request->next = request;
+  else
+    first_request = request;
+  last_request = request;
+  SDL_CondSignal(image_loader_cond);
+  SDL_UnlockMutex(image_loader_mutex);
+}
+
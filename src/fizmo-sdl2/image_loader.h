@@ -0,0 +1,71 @@
+/* image_loader.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A small pool of worker threads which decode and scale blorb pictures
+ * into the image cache, so that neither the SDL main thread nor the
+ * interpreter have to wait for PNG or JPEG decoding.
+ *
+ */
+
+
+#ifndef image_loader_h_INCLUDED
+#define image_loader_h_INCLUDED
+
+#include <tools/types.h>
+
+#include "image_cache.h"
+
+#define DEFAULT_NUMBER_OF_IMAGE_LOADER_THREADS 2
+
+// Invoked on a worker thread once the picture is available. "image" is
+// NULL in case the picture could not be loaded, otherwise the callback
+// has to release it using release_cached_image.
+typedef void (*image_loader_callback)(cached_image *image,
+    void *callback_data);
+
+void set_number_of_image_loader_threads(int nof_threads);
+int get_number_of_image_loader_threads();
+
+void start_image_loader();
+// Drops all pending requests and waits for the running ones to finish.
+void stop_image_loader();
+
+// Queues the given picture for loading. In case no worker threads are
+// running, the picture is loaded and the callback is invoked right away.
+void load_blorb_image_async(int resource_number, int width, int height,
+    uint32_t pixel_format, image_loader_callback callback,
+    void *callback_data);
+
+#endif // image_loader_h_INCLUDED
+
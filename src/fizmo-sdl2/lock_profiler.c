@@ -0,0 +1,331 @@
+/* lock_profiler.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+
+#include "lock_profiler.h"
+#include "event_trace.h"
+#include "profile_output.h"
+
+struct profiled_lock_type {
+  char *name;
+  bool is_cond;
+  enum trace_event_id trace_id;
+};
+
+// For condition variables, "acquisitions" counts waits and only the wait
+// fields are used.
+struct lock_profile {
+  unsigned long acquisitions;
+  unsigned long contended;
+  Uint64 total_wait;
+  Uint64 max_wait;
+  Uint64 total_hold;
+  Uint64 max_hold;
+  Uint64 acquired_at;
+  unsigned long wait_histogram[LOCK_PROFILE_HISTOGRAM_BUCKETS];
+  unsigned long hold_histogram[LOCK_PROFILE_HISTOGRAM_BUCKETS];
+};
+
+static struct profiled_lock_type profiled_lock_types[NUMBER_OF_PROFILED_LOCKS]
+= {
+  { "sdl_main_thread_working_mutex", false, TRACE_WAIT_MAIN_THREAD_MUTEX },
+  { "sdl_backup_surface_mutex", false, TRACE_WAIT_BACKUP_SURFACE_MUTEX },
+  { "sdl_event_queue_mutex", false, TRACE_WAIT_EVENT_QUEUE_MUTEX },
+  { "resize_event_pending_mutex", false, TRACE_WAIT_RESIZE_MUTEX },
+  { "timeout_semaphore", false, TRACE_WAIT_TIMEOUT_SEMAPHORE },
+  { "update_screen_wait_cond", true, TRACE_WAIT_UPDATE_SCREEN_COND },
+  { "sdl_main_thread_working_cond", true,
+    TRACE_WAIT_MAIN_THREAD_WORKING_COND },
+  { "interpreter_finished_processing_winch_cond", true,
+    TRACE_WAIT_WINCH_COND }
+};
+
+static struct lock_profile lock_profiles[NUMBER_OF_PROFILED_LOCKS];
+
+bool lock_profiling_enabled = false;
+
+static bool lock_profile_requested = false;
+static bool lock_statistics_requested = false;
+
+
+void set_lock_profiling_enabled(bool enabled) {
+  lock_profile_requested = enabled;
+  lock_profiling_enabled
+    = (lock_profile_requested == true) || (lock_statistics_requested == true);
+}
+
+
+bool is_lock_profiling_enabled() {
+  return lock_profile_requested;
+}
+
+
+void set_lock_statistics_enabled(bool enabled) {
+  lock_statistics_requested = enabled;
+  lock_profiling_enabled
+    = (lock_profile_requested == true) || (lock_statistics_requested == true);
+}
+
+
+static Uint64 ticks_to_us(Uint64 ticks) {
+  return ticks * 1000000 / SDL_GetPerformanceFrequency();
+}
+
+
+static void add_to_histogram(unsigned long *histogram, Uint64 ticks) {
+  Uint64 us = ticks_to_us(ticks);
+  int bucket = 0;
+
+  while ( (us > 0) && (bucket < LOCK_PROFILE_HISTOGRAM_BUCKETS - 1) ) {
+    us >>= 1;
+    bucket++;
+  }
+
+  histogram[bucket]++;
+}
+
+
+static void add_wait(struct lock_profile *profile, Uint64 wait) {
+  profile->total_wait += wait;
+  if (wait > profile->max_wait)
+    profile->max_wait = wait;
+  add_to_histogram(profile->wait_histogram, wait);
+}
+
+
+// Invoked with the lock held. "start" is when waiting for it began in
+// case it was contended.
+static void lock_acquired(struct lock_profile *profile, bool contended,
+    Uint64 start) {
+  Uint64 now;
+
+  if (lock_profiling_enabled == false)
+    return;
+
+  now = SDL_GetPerformanceCounter();
+  profile->acquisitions++;
+  if (contended == true)
+    profile->contended++;
+  add_wait(profile, contended == true ? now - start : 0);
+  profile->acquired_at = now;
+}
+
+
+// Invoked with the lock still held.
+static void lock_released(struct lock_profile *profile) {
+  Uint64 hold;
+
+  if (profile->acquired_at == 0)
+    return;
+
+  hold = SDL_GetPerformanceCounter() - profile->acquired_at;
+  profile->acquired_at = 0;
+  profile->total_hold += hold;
+  if (hold > profile->max_hold)
+    profile->max_hold = hold;
+  add_to_histogram(profile->hold_histogram, hold);
+}
+
+
+void profile_mutex_lock(SDL_mutex *mutex, enum profiled_lock_id id) {
+  struct lock_profile *profile = &lock_profiles[id];
+  enum trace_event_id trace_id = profiled_lock_types[id].trace_id;
+  Uint64 start;
+
+  if (SDL_TryLockMutex(mutex) == 0) {
+    lock_acquired(profile, false, 0);
+    return;
+  }
+
+  trace_begin(trace_id, 0);
+  start = SDL_GetPerformanceCounter();
+  SDL_LockMutex(mutex);
+  trace_end(trace_id);
+  lock_acquired(profile, true, start);
+}
+
+
+void profile_mutex_unlock(SDL_mutex *mutex, enum profiled_lock_id id) {
+  lock_released(&lock_profiles[id]);
+  SDL_UnlockMutex(mutex);
+}
+
+
+void profile_semaphore_wait(SDL_sem *semaphore, enum profiled_lock_id id) {
+  struct lock_profile *profile = &lock_profiles[id];
+  enum trace_event_id trace_id = profiled_lock_types[id].trace_id;
+  Uint64 start;
+
+  if (SDL_SemTryWait(semaphore) == 0) {
+    lock_acquired(profile, false, 0);
+    return;
+  }
+
+  trace_begin(trace_id, 0);
+  start = SDL_GetPerformanceCounter();
+  SDL_SemWait(semaphore);
+  trace_end(trace_id);
+  lock_acquired(profile, true, start);
+}
+
+
+void profile_semaphore_post(SDL_sem *semaphore, enum profiled_lock_id id) {
+  lock_released(&lock_profiles[id]);
+  SDL_SemPost(semaphore);
+}
+
+
+void profile_cond_wait(SDL_cond *cond, enum profiled_lock_id cond_id,
+    SDL_mutex *mutex, enum profiled_lock_id mutex_id) {
+  struct lock_profile *cond_profile = &lock_profiles[cond_id];
+  enum trace_event_id trace_id = profiled_lock_types[cond_id].trace_id;
+  struct lock_profile *mutex_profile = &lock_profiles[mutex_id];
+  Uint64 start, now;
+
+  lock_released(mutex_profile);
+
+  trace_begin(trace_id, 0);
+  start = SDL_GetPerformanceCounter();
+  SDL_CondWait(cond, mutex);
+  now = SDL_GetPerformanceCounter();
+  trace_end(trace_id);
+
+  if (lock_profiling_enabled == true) {
+    cond_profile->acquisitions++;
+    add_wait(cond_profile, now - start);
+    mutex_profile->acquired_at = now;
+  }
+}
+
+
+void get_lock_wait_statistics(enum profiled_lock_id id,
+    unsigned long *waits, double *total_wait_ms, double *max_wait_ms) {
+  *waits = lock_profiles[id].acquisitions;
+  *total_wait_ms = profile_ticks_to_ms(lock_profiles[id].total_wait);
+  *max_wait_ms = profile_ticks_to_ms(lock_profiles[id].max_wait);
+}
+
+
+char *get_profiled_lock_name(enum profiled_lock_id id) {
+  return profiled_lock_types[id].name;
+}
+
+
+bool is_profiled_cond(enum profiled_lock_id id) {
+  return profiled_lock_types[id].is_cond;
+}
+
+
+static void print_histogram(char *name, char *kind,
+    unsigned long *histogram) {
+  int last_bucket, i;
+
+  for (last_bucket = LOCK_PROFILE_HISTOGRAM_BUCKETS - 1; last_bucket >= 0;
+      last_bucket--)
+    if (histogram[last_bucket] != 0)
+      break;
+
+  if (last_bucket < 0)
+    return;
+
+  fprintf(stderr, "%-44s %s:", name, kind);
+  for (i=0; i<=last_bucket; i++) {
+    if (i == LOCK_PROFILE_HISTOGRAM_BUCKETS - 1)
+      fprintf(stderr, " >=%lu:%lu", 1UL << (i - 1), histogram[i]);
+    else
+      fprintf(stderr, " <%lu:%lu", 1UL << i, histogram[i]);
+  }
+  fputs("\n", stderr);
+}
+
+
+void print_lock_profile() {
+  struct lock_profile *profile;
+  struct profiled_lock_type *type;
+  int i;
+
+  if (lock_profile_requested == false)
+    return;
+
+  fprintf(stderr, "\n%-44s %9s %9s %12s %10s %12s %10s\n",
+      "lock", "acquired", "contended", "wait ms", "max ms", "hold ms",
+      "max ms");
+  for (i=0; i<NUMBER_OF_PROFILED_LOCKS; i++) {
+    profile = &lock_profiles[i];
+    type = &profiled_lock_types[i];
+    if (type->is_cond == true)
+      continue;
+    fprintf(stderr, "%-44s %9lu %8.1f%% %12.3f %10.3f %12.3f %10.3f\n",
+        type->name,
+        profile->acquisitions,
+        profile->acquisitions > 0
+        ? 100.0 * profile->contended / profile->acquisitions
+        : 0.0,
+        profile_ticks_to_ms(profile->total_wait),
+        profile_ticks_to_ms(profile->max_wait),
+        profile_ticks_to_ms(profile->total_hold),
+        profile_ticks_to_ms(profile->max_hold));
+  }
+
+  fprintf(stderr, "\n%-44s %9s %9s %12s %10s\n",
+      "condition variable", "waits", "", "wait ms", "max ms");
+  for (i=0; i<NUMBER_OF_PROFILED_LOCKS; i++) {
+    profile = &lock_profiles[i];
+    type = &profiled_lock_types[i];
+    if (type->is_cond == false)
+      continue;
+    fprintf(stderr, "%-44s %9lu %9s %12.3f %10.3f\n",
+        type->name,
+        profile->acquisitions,
+        "",
+        profile_ticks_to_ms(profile->total_wait),
+        profile_ticks_to_ms(profile->max_wait));
+  }
+
+  fprintf(stderr, "\nLatency histograms, bucket limits in microseconds:\n");
+  for (i=0; i<NUMBER_OF_PROFILED_LOCKS; i++) {
+    profile = &lock_profiles[i];
+    type = &profiled_lock_types[i];
+    print_histogram(type->name, "wait", profile->wait_histogram);
+    if (type->is_cond == false)
+      print_histogram(type->name, "hold", profile->hold_histogram);
+  }
+  fputs("\n", stderr);
+}
+
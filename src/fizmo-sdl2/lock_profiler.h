@@ -0,0 +1,146 @@
+/* lock_profiler.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ * Wrappers around the frontend's mutexes, semaphore and condition
+ * variables which measure how long threads wait to acquire them, how
+ * long they hold them and how long they wait for a condition. Once
+ * profiling is turned on, a contention table and latency histograms are
+ * printed to stderr on exit. Contended waits also show up in the event
+ * trace, in case it's enabled. The statistics may also be collected
+ * without printing them, for the counters report.
+ *
+ * The statistics of every lock are only updated while the lock is held,
+ * and those of a condition variable while the mutex it's used with is
+ * held, so no additional synchronization is required. This means that a
+ * condition variable must always be used with the same mutex.
+ *
+ */
+
+
+#ifndef lock_profiler_h_INCLUDED
+#define lock_profiler_h_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#include "event_trace.h"
+
+// Buckets are powers of two in microseconds, the first one covers
+// everything below one microsecond, the last one everything above.
+#define LOCK_PROFILE_HISTOGRAM_BUCKETS 24
+
+enum profiled_lock_id {
+  LOCK_MAIN_THREAD_WORKING,
+  LOCK_BACKUP_SURFACE,
+  LOCK_EVENT_QUEUE,
+  LOCK_RESIZE_EVENT_PENDING,
+  LOCK_TIMEOUT_SEMAPHORE,
+  COND_UPDATE_SCREEN_WAIT,
+  COND_MAIN_THREAD_WORKING,
+  COND_WINCH,
+  NUMBER_OF_PROFILED_LOCKS
+};
+
+void set_lock_profiling_enabled(bool enabled);
+bool is_lock_profiling_enabled();
+void set_lock_statistics_enabled(bool enabled);
+
+// Returns the number of waits and the total and longest wait time of the
+// given lock or condition variable.
+void get_lock_wait_statistics(enum profiled_lock_id id,
+    unsigned long *waits, double *total_wait_ms, double *max_wait_ms);
+char *get_profiled_lock_name(enum profiled_lock_id id);
+bool is_profiled_cond(enum profiled_lock_id id);
+
+// Prints the contention table and histograms to stderr in case profiling
+// is enabled.
+void print_lock_profile();
+
+// The fast paths are inlined, so that locking costs no more than a
+// branch as long as neither profiling nor tracing are turned on. This
+// flag is set as soon as the statistics are collected for any purpose.
+extern bool lock_profiling_enabled;
+
+void profile_mutex_lock(SDL_mutex *mutex, enum profiled_lock_id id);
+void profile_mutex_unlock(SDL_mutex *mutex, enum profiled_lock_id id);
+void profile_semaphore_wait(SDL_sem *semaphore, enum profiled_lock_id id);
+void profile_semaphore_post(SDL_sem *semaphore, enum profiled_lock_id id);
+void profile_cond_wait(SDL_cond *cond, enum profiled_lock_id cond_id,
+    SDL_mutex *mutex, enum profiled_lock_id mutex_id);
+
+static inline void lock_profiled_mutex(SDL_mutex *mutex,
+    enum profiled_lock_id id) {
+  if ( (lock_profiling_enabled == false) && (event_tracing_enabled == false) )
+    SDL_LockMutex(mutex);
+  else
+    profile_mutex_lock(mutex, id);
+}
+
+static inline void unlock_profiled_mutex(SDL_mutex *mutex,
+    enum profiled_lock_id id) {
+  if (lock_profiling_enabled == false)
+    SDL_UnlockMutex(mutex);
+  else
+    profile_mutex_unlock(mutex, id);
+}
+
+// The semaphore is used as a mutex, its hold time is measured likewise.
+static inline void wait_profiled_semaphore(SDL_sem *semaphore,
+    enum profiled_lock_id id) {
+  if ( (lock_profiling_enabled == false) && (event_tracing_enabled == false) )
+    SDL_SemWait(semaphore);
+  else
+    profile_semaphore_wait(semaphore, id);
+}
+
+static inline void post_profiled_semaphore(SDL_sem *semaphore,
+    enum profiled_lock_id id) {
+  if (lock_profiling_enabled == false)
+    SDL_SemPost(semaphore);
+  else
+    profile_semaphore_post(semaphore, id);
+}
+
+// Waiting for the condition ends the mutex's current hold time.
+static inline void wait_profiled_cond(SDL_cond *cond,
+    enum profiled_lock_id cond_id, SDL_mutex *mutex,
+    enum profiled_lock_id mutex_id) {
+  if ( (lock_profiling_enabled == false) && (event_tracing_enabled == false) )
+    SDL_CondWait(cond, mutex);
+  else
+    profile_cond_wait(cond, cond_id, mutex, mutex_id);
+}
+
+#endif // lock_profiler_h_INCLUDED
+
@@ -0,0 +1,506 @@
+/* mmap_filesys.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/filesys.h>
+#include <interpreter/fizmo.h>
+
+#include "mmap_filesys.h"
+
+struct mapped_file {
+  // The "file_object" of this z_file points to the z_file itself, which
+  // is how mapped files are told apart from the wrapped interface's ones.
+  z_file zfile;
+  int fd;
+  uint8_t *data;
+  size_t size;
+  size_t pos;
+  // Once code has asked for a stdio stream, all further reads go through
+  // this stream, so that its position and the file's one never diverge.
+  FILE *stdio_stream;
+};
+
+// Mapped address ranges, looked up by the SIGBUS handler. A slot is
+// claimed by storing its start address, and only matched once its size
+// has been stored, too.
+#define MAX_MAPPED_REGIONS 32
+
+struct mapped_region {
+  void *start;
+  size_t size;
+};
+
+static struct z_filesys_interface *wrapped_fsi = NULL;
+static struct z_filesys_interface mmap_fsi;
+static struct mapped_region mapped_regions[MAX_MAPPED_REGIONS];
+static struct sigaction previous_sigbus_action;
+static long page_size;
+
+
+static bool is_mapped_file(z_file *file) {
+  return file->file_object == (void*)file;
+}
+
+
+// A file which is truncated while it's mapped makes accesses to the pages
+// beyond its new end raise SIGBUS. These pages are replaced with zeroed
+// ones, so the story reads garbage instead of the process being killed.
+static void handle_sigbus(int sig, siginfo_t *info, void *context) {
+  uint8_t *addr = info->si_addr, *start, *page;
+  size_t size;
+  int i;
+
+  for (i=0; i<MAX_MAPPED_REGIONS; i++) {
+    start = SDL_AtomicGetPtr(&mapped_regions[i].start);
+    size = mapped_regions[i].size;
+    if ( (start != NULL) && (addr >= start) && (addr < start + size) ) {
+      page = start + ((addr - start) & ~(page_size - 1));
+      if (mmap(page, page_size, PROT_READ,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)
+        return;
+      break;
+    }
+  }
+
+  if (previous_sigbus_action.sa_flags & SA_SIGINFO) {
+    previous_sigbus_action.sa_sigaction(sig, info, context);
+  }
+  else if ( (previous_sigbus_action.sa_handler != SIG_DFL)
+      && (previous_sigbus_action.sa_handler != SIG_IGN) ) {
+    previous_sigbus_action.sa_handler(sig);
+  }
+  else {
+    // Returning re-executes the faulting access, which now terminates.
+    signal(SIGBUS, SIG_DFL);
+  }
+}
+
+
+static bool add_mapped_region(void *start, size_t size) {
+  int i;
+
+  for (i=0; i<MAX_MAPPED_REGIONS; i++) {
+    if (SDL_AtomicCASPtr(&mapped_regions[i].start, NULL, start) == SDL_TRUE) {
+      mapped_regions[i].size = size;
+      SDL_MemoryBarrierRelease();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+static void remove_mapped_region(void *start) {
+  int i;
+
+  for (i=0; i<MAX_MAPPED_REGIONS; i++) {
+    if (SDL_AtomicGetPtr(&mapped_regions[i].start) == start) {
+      mapped_regions[i].size = 0;
+      SDL_AtomicSetPtr(&mapped_regions[i].start, NULL);
+      return;
+    }
+  }
+}
+
+
+static z_file *mmap_openfile(char *filename, int filetype, int fileaccess) {
+  struct mapped_file *mapped;
+  struct stat file_stat;
+  uint8_t *data;
+  int fd;
+
+  if ( (filetype != FILETYPE_DATA) || (fileaccess != FILEACCESS_READ) )
+    return wrapped_fsi->openfile(filename, filetype, fileaccess);
+
+  if ((fd = open(filename, O_RDONLY)) == -1)
+    return wrapped_fsi->openfile(filename, filetype, fileaccess);
+
+  if ( (fstat(fd, &file_stat) != 0)
+      || (!S_ISREG(file_stat.st_mode))
+      || (file_stat.st_size == 0)
+      || ((data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+        == MAP_FAILED) ) {
+    close(fd);
+    return wrapped_fsi->openfile(filename, filetype, fileaccess);
+  }
+
+  if (add_mapped_region(data, file_stat.st_size) == false) {
+    // No SIGBUS protection available, rather don't map at all.
+    munmap(data, file_stat.st_size);
+    close(fd);
+    return wrapped_fsi->openfile(filename, filetype, fileaccess);
+  }
+
+#ifdef MADV_SEQUENTIAL
+  // Story files are read in one go, while blorb chunks are accessed
+  // randomly on demand.
+  if ( (file_stat.st_size >= 12)
+      && (memcmp(data, "FORM", 4) == 0)
+      && (memcmp(data + 8, "IFRS", 4) == 0) ) {
+    madvise(data, file_stat.st_size, MADV_RANDOM);
+  }
+  else {
+    madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+    madvise(data, file_stat.st_size, MADV_WILLNEED);
+  }
+#endif // MADV_SEQUENTIAL
+
+  TRACE_LOG("Mapped \"%s\", %ld bytes.\n", filename, (long)file_stat.st_size);
+
+  mapped = fizmo_malloc(sizeof(struct mapped_file));
+  mapped->zfile.file_object = &mapped->zfile;
+  mapped->zfile.filetype = filetype;
+  mapped->zfile.fileaccess = fileaccess;
+  mapped->zfile.filename = strdup(filename);
+  mapped->fd = fd;
+  mapped->data = data;
+  mapped->size = file_stat.st_size;
+  mapped->pos = 0;
+  mapped->stdio_stream = NULL;
+
+  return &mapped->zfile;
+}
+
+
+static int mmap_closefile(z_file *file_to_close) {
+  struct mapped_file *mapped = (struct mapped_file*)file_to_close;
+
+  if (!is_mapped_file(file_to_close))
+    return wrapped_fsi->closefile(file_to_close);
+
+  if (mapped->stdio_stream != NULL)
+    fclose(mapped->stdio_stream);
+  remove_mapped_region(mapped->data);
+  munmap(mapped->data, mapped->size);
+  close(mapped->fd);
+  free(mapped->zfile.filename);
+  free(mapped);
+
+  return 0;
+}
+
+
+static int mmap_readchar(z_file *fileref) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->readchar(fileref);
+
+  if (mapped->stdio_stream != NULL)
+    return fgetc(mapped->stdio_stream);
+
+  return mapped->pos < mapped->size ? mapped->data[mapped->pos++] : EOF;
+}
+
+
+static size_t mmap_readchars(void *ptr, size_t len, z_file *fileref) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->readchars(ptr, len, fileref);
+
+  if (mapped->stdio_stream != NULL)
+    return fread(ptr, 1, len, mapped->stdio_stream);
+
+  if (mapped->pos >= mapped->size)
+    return 0;
+  if (len > mapped->size - mapped->pos)
+    len = mapped->size - mapped->pos;
+
+  memcpy(ptr, mapped->data + mapped->pos, len);
+  mapped->pos += len;
+
+  return len;
+}
+
+
+// Mapped files are read-only, so all writes fail.
+static int mmap_writechar(int ch, z_file *fileref) {
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->writechar(ch, fileref);
+
+  return EOF;
+}
+
+
+static size_t mmap_writechars(void *ptr, size_t len, z_file *fileref) {
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->writechars(ptr, len, fileref);
+
+  return 0;
+}
+
+
+static int mmap_writestring(char *s, z_file *fileref) {
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->writestring(s, fileref);
+
+  return EOF;
+}
+
+
+static int mmap_writeucsstring(z_ucs *s, z_file *fileref) {
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->writeucsstring(s, fileref);
+
+  return EOF;
+}
+
+
+static int mmap_vfileprintf(z_file *fileref, char *format, va_list ap) {
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->vfileprintf(fileref, format, ap);
+
+  return -1;
+}
+
+
+static int mmap_fileprintf(z_file *fileref, char *format, ...) {
+  va_list args;
+  int result;
+
+  va_start(args, format);
+  result = mmap_vfileprintf(fileref, format, args);
+  va_end(args);
+
+  return result;
+}
+
+
+static FILE* mmap_get_stdio_stream(z_file *fileref);
+
+
+static int mmap_vfilescanf(z_file *fileref, char *format, va_list ap) {
+  FILE *stream;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->vfilescanf(fileref, format, ap);
+
+  if ((stream = mmap_get_stdio_stream(fileref)) == NULL)
+    return EOF;
+
+  return vfscanf(stream, format, ap);
+}
+
+
+static int mmap_filescanf(z_file *fileref, char *format, ...) {
+  va_list args;
+  int result;
+
+  va_start(args, format);
+  result = mmap_vfilescanf(fileref, format, args);
+  va_end(args);
+
+  return result;
+}
+
+
+static long mmap_getfilepos(z_file *fileref) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->getfilepos(fileref);
+
+  if (mapped->stdio_stream != NULL)
+    return ftell(mapped->stdio_stream);
+
+  return mapped->pos;
+}
+
+
+static int mmap_setfilepos(z_file *fileref, long seek, int whence) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+  long new_pos;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->setfilepos(fileref, seek, whence);
+
+  if (mapped->stdio_stream != NULL)
+    return fseek(mapped->stdio_stream, seek, whence);
+
+  if (whence == SEEK_SET)
+    new_pos = seek;
+  else if (whence == SEEK_CUR)
+    new_pos = (long)mapped->pos + seek;
+  else if (whence == SEEK_END)
+    new_pos = (long)mapped->size + seek;
+  else
+    return -1;
+
+  // Like fseek, allow positioning beyond the end, reads will return EOF.
+  if (new_pos < 0)
+    return -1;
+
+  mapped->pos = new_pos;
+  return 0;
+}
+
+
+static int mmap_unreadchar(int c, z_file *fileref) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->unreadchar(c, fileref);
+
+  if (mapped->stdio_stream != NULL)
+    return ungetc(c, mapped->stdio_stream);
+
+  if ( (c == EOF) || (mapped->pos == 0) )
+    return EOF;
+
+  mapped->pos--;
+  return c;
+}
+
+
+static int mmap_flushfile(z_file *fileref) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->flushfile(fileref);
+
+  if (mapped->stdio_stream != NULL)
+    return fflush(mapped->stdio_stream);
+
+  return 0;
+}
+
+
+static time_t mmap_get_last_file_mod_timestamp(z_file *fileref) {
+  struct stat file_stat;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->get_last_file_mod_timestamp(fileref);
+
+  if (fstat(((struct mapped_file*)fileref)->fd, &file_stat) != 0)
+    return -1;
+
+  return file_stat.st_mtime;
+}
+
+
+static int mmap_get_fileno(z_file *fileref) {
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->get_fileno(fileref);
+
+  return ((struct mapped_file*)fileref)->fd;
+}
+
+
+// Code which insists on a stdio stream gets one positioned at the current
+// read position. From then on the file falls back to this stream for all
+// reads, so that these advance the same position.
+static FILE* mmap_get_stdio_stream(z_file *fileref) {
+  struct mapped_file *mapped = (struct mapped_file*)fileref;
+  int fd;
+
+  if (!is_mapped_file(fileref))
+    return wrapped_fsi->get_stdio_stream(fileref);
+
+  if (mapped->stdio_stream == NULL) {
+    if ((fd = dup(mapped->fd)) == -1)
+      return NULL;
+    if ((mapped->stdio_stream = fdopen(fd, "rb")) == NULL) {
+      close(fd);
+      return NULL;
+    }
+    fseek(mapped->stdio_stream, mapped->pos, SEEK_SET);
+  }
+
+  return mapped->stdio_stream;
+}
+
+
+uint8_t *get_mapped_file_data(z_file *file, size_t *size) {
+  if ( (file == NULL) || (!is_mapped_file(file)) )
+    return NULL;
+
+  *size = ((struct mapped_file*)file)->size;
+  return ((struct mapped_file*)file)->data;
+}
+
+
+void register_mmap_filesys_interface() {
+  struct sigaction sigbus_action;
+
+  if (wrapped_fsi != NULL)
+    return;
+
+  page_size = sysconf(_SC_PAGESIZE);
+  memset(&sigbus_action, 0, sizeof(sigbus_action));
+  sigbus_action.sa_sigaction = &handle_sigbus;
+  sigbus_action.sa_flags = SA_SIGINFO;
+  sigemptyset(&sigbus_action.sa_mask);
+  if (sigaction(SIGBUS, &sigbus_action, &previous_sigbus_action) != 0)
+    return;
+
+  wrapped_fsi = fsi;
+  mmap_fsi = *wrapped_fsi;
+
+  mmap_fsi.openfile = &mmap_openfile;
+  mmap_fsi.closefile = &mmap_closefile;
+  mmap_fsi.readchar = &mmap_readchar;
+  mmap_fsi.readchars = &mmap_readchars;
+  mmap_fsi.writechar = &mmap_writechar;
+  mmap_fsi.writechars = &mmap_writechars;
+  mmap_fsi.writestring = &mmap_writestring;
+  mmap_fsi.writeucsstring = &mmap_writeucsstring;
+  mmap_fsi.fileprintf = &mmap_fileprintf;
+  mmap_fsi.vfileprintf = &mmap_vfileprintf;
+  mmap_fsi.filescanf = &mmap_filescanf;
+  mmap_fsi.vfilescanf = &mmap_vfilescanf;
+  mmap_fsi.getfilepos = &mmap_getfilepos;
+  mmap_fsi.setfilepos = &mmap_setfilepos;
+  mmap_fsi.unreadchar = &mmap_unreadchar;
+  mmap_fsi.flushfile = &mmap_flushfile;
+  mmap_fsi.get_last_file_mod_timestamp = &mmap_get_last_file_mod_timestamp;
+  mmap_fsi.get_fileno = &mmap_get_fileno;
+  mmap_fsi.get_stdio_stream = &mmap_get_stdio_stream;
+
+  fizmo_register_filesys_interface(&mmap_fsi);
+}
+
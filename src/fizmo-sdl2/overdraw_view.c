@@ -0,0 +1,366 @@
+/* overdraw_view.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+
+#include "overdraw_view.h"
+
+#define NUMBER_OF_OVERDRAW_LEVELS 4
+
+enum overdraw_view_mode {
+  OVERDRAW_VIEW_OFF,
+  OVERDRAW_VIEW_HEATMAP,
+  OVERDRAW_VIEW_UPLOADS,
+  OVERDRAW_VIEW_BOTH,
+  NUMBER_OF_OVERDRAW_VIEW_MODES
+};
+
+static char *overdraw_view_mode_names[NUMBER_OF_OVERDRAW_VIEW_MODES] = {
+  "off", "heatmap", "uploads", "both" };
+
+static uint8_t overdraw_level_colours[NUMBER_OF_OVERDRAW_LEVELS][4] = {
+  { 0x30, 0x60, 0xff, 0x50 },
+  { 0x30, 0xd0, 0x30, 0x60 },
+  { 0xff, 0x60, 0xc0, 0x70 },
+  { 0xff, 0x20, 0x20, 0x80 }
+};
+
+bool overdraw_counting_enabled = false;
+uint32_t *overdraw_tiles = NULL;
+int overdraw_tiles_per_row = 0;
+
+static enum overdraw_view_mode configured_mode = OVERDRAW_VIEW_OFF;
+static enum overdraw_view_mode current_mode = OVERDRAW_VIEW_OFF;
+static SDL_Renderer *overdraw_renderer = NULL;
+
+// Written by the interpreter thread only.
+static int overdraw_tile_rows = 0;
+static int framebuffer_width = 0;
+static int framebuffer_height = 0;
+
+// The following is only accessed by the main thread. Levels are 0 for
+// tiles which haven't been written, and otherwise the number of times
+// their pixels have been written on average, rounded up and capped.
+static uint8_t *displayed_levels = NULL;
+static int displayed_tiles_per_row = 0;
+static int displayed_tile_rows = 0;
+static SDL_FRect *heatmap_rects = NULL;
+static SDL_FRect *uploaded_rects = NULL;
+static int nof_uploaded_rects = 0;
+static int uploaded_rects_size = 0;
+static Uint32 flash_started_at;
+
+
+int set_overdraw_view(char *mode_name) {
+  int i;
+
+  for (i=0; i<NUMBER_OF_OVERDRAW_VIEW_MODES; i++)
+    if (strcasecmp(mode_name, overdraw_view_mode_names[i]) == 0)
+      break;
+
+  if (i == NUMBER_OF_OVERDRAW_VIEW_MODES)
+    return -1;
+
+  configured_mode = i;
+  current_mode = i;
+  overdraw_counting_enabled = configured_mode != OVERDRAW_VIEW_OFF;
+  return 0;
+}
+
+
+char *get_overdraw_view() {
+  return overdraw_view_mode_names[configured_mode];
+}
+
+
+void init_overdraw_view(SDL_Renderer *renderer) {
+  overdraw_renderer = configured_mode != OVERDRAW_VIEW_OFF ? renderer : NULL;
+}
+
+
+void free_overdraw_view() {
+  free(overdraw_tiles);
+  free(displayed_levels);
+  free(heatmap_rects);
+  free(uploaded_rects);
+  overdraw_tiles = NULL;
+  displayed_levels = NULL;
+  heatmap_rects = NULL;
+  uploaded_rects = NULL;
+  displayed_tiles_per_row = 0;
+  displayed_tile_rows = 0;
+  nof_uploaded_rects = 0;
+  uploaded_rects_size = 0;
+  overdraw_renderer = NULL;
+}
+
+
+void init_overdraw_map(int width, int height) {
+  if (overdraw_counting_enabled == false)
+    return;
+
+  free(overdraw_tiles);
+
+  framebuffer_width = width;
+  framebuffer_height = height;
+  overdraw_tiles_per_row
+    = (width + OVERDRAW_TILE_SIZE - 1) >> OVERDRAW_TILE_SHIFT;
+  overdraw_tile_rows
+    = (height + OVERDRAW_TILE_SIZE - 1) >> OVERDRAW_TILE_SHIFT;
+
+  overdraw_tiles = fizmo_malloc(
+      sizeof(uint32_t) * overdraw_tiles_per_row * overdraw_tile_rows);
+  memset(overdraw_tiles, 0,
+      sizeof(uint32_t) * overdraw_tiles_per_row * overdraw_tile_rows);
+}
+
+
+void count_overdrawn_area(int x, int y, int width, int height) {
+  int column, end_column, row, end_row;
+  int tile_left, tile_top, overlap_width, overlap_height;
+
+  if (overdraw_counting_enabled == false)
+    return;
+
+  if (x < 0) {
+    width += x;
+    x = 0;
+  }
+  if (y < 0) {
+    height += y;
+    y = 0;
+  }
+  if (x + width > framebuffer_width)
+    width = framebuffer_width - x;
+  if (y + height > framebuffer_height)
+    height = framebuffer_height - y;
+  if ( (width <= 0) || (height <= 0) )
+    return;
+
+  end_column = ((x + width - 1) >> OVERDRAW_TILE_SHIFT) + 1;
+  end_row = ((y + height - 1) >> OVERDRAW_TILE_SHIFT) + 1;
+
+  for (row = y >> OVERDRAW_TILE_SHIFT; row < end_row; row++) {
+    tile_top = row << OVERDRAW_TILE_SHIFT;
+    overlap_height
+      = (tile_top + OVERDRAW_TILE_SIZE < y + height
+          ? tile_top + OVERDRAW_TILE_SIZE : y + height)
+      - (tile_top > y ? tile_top : y);
+
+    for (column = x >> OVERDRAW_TILE_SHIFT; column < end_column; column++) {
+      tile_left = column << OVERDRAW_TILE_SHIFT;
+      overlap_width
+        = (tile_left + OVERDRAW_TILE_SIZE < x + width
+            ? tile_left + OVERDRAW_TILE_SIZE : x + width)
+        - (tile_left > x ? tile_left : x);
+      overdraw_tiles[row * overdraw_tiles_per_row + column]
+        += overlap_width * overlap_height;
+    }
+  }
+}
+
+
+void collect_overdraw_map() {
+  int row, column, tile_width, tile_height;
+  uint32_t count, tile_area, level;
+
+  if (overdraw_counting_enabled == false)
+    return;
+
+  nof_uploaded_rects = 0;
+  flash_started_at = SDL_GetTicks();
+
+  if ( (displayed_tiles_per_row != overdraw_tiles_per_row)
+      || (displayed_tile_rows != overdraw_tile_rows) ) {
+    free(displayed_levels);
+    free(heatmap_rects);
+    displayed_tiles_per_row = overdraw_tiles_per_row;
+    displayed_tile_rows = overdraw_tile_rows;
+    displayed_levels = fizmo_malloc(
+        displayed_tiles_per_row * displayed_tile_rows);
+    // Every row holds at most one run per tile.
+    heatmap_rects = fizmo_malloc(
+        sizeof(SDL_FRect) * displayed_tiles_per_row * displayed_tile_rows);
+  }
+
+  for (row=0; row<overdraw_tile_rows; row++) {
+    tile_height = framebuffer_height - (row << OVERDRAW_TILE_SHIFT);
+    if (tile_height > OVERDRAW_TILE_SIZE)
+      tile_height = OVERDRAW_TILE_SIZE;
+
+    for (column=0; column<overdraw_tiles_per_row; column++) {
+      tile_width = framebuffer_width - (column << OVERDRAW_TILE_SHIFT);
+      if (tile_width > OVERDRAW_TILE_SIZE)
+        tile_width = OVERDRAW_TILE_SIZE;
+      tile_area = tile_width * tile_height;
+
+      count = overdraw_tiles[row * overdraw_tiles_per_row + column];
+      level = (count + tile_area - 1) / tile_area;
+      displayed_levels[row * displayed_tiles_per_row + column]
+        = level > NUMBER_OF_OVERDRAW_LEVELS ? NUMBER_OF_OVERDRAW_LEVELS : level;
+    }
+  }
+
+  memset(overdraw_tiles, 0,
+      sizeof(uint32_t) * overdraw_tiles_per_row * overdraw_tile_rows);
+}
+
+
+void overdraw_area_uploaded(SDL_Rect *rect) {
+  if (overdraw_renderer == NULL)
+    return;
+
+  if (nof_uploaded_rects == uploaded_rects_size) {
+    uploaded_rects_size += 32;
+    uploaded_rects = fizmo_realloc(
+        uploaded_rects, sizeof(SDL_FRect) * uploaded_rects_size);
+  }
+
+  uploaded_rects[nof_uploaded_rects].x = rect->x;
+  uploaded_rects[nof_uploaded_rects].y = rect->y;
+  uploaded_rects[nof_uploaded_rects].w = rect->w;
+  uploaded_rects[nof_uploaded_rects].h = rect->h;
+  nof_uploaded_rects++;
+}
+
+
+bool cycle_overdraw_view() {
+  if (overdraw_renderer == NULL)
+    return false;
+
+  current_mode = (current_mode + 1) % NUMBER_OF_OVERDRAW_VIEW_MODES;
+  TRACE_LOG("Overdraw view: %s.\n", overdraw_view_mode_names[current_mode]);
+  return true;
+}
+
+
+bool update_overdraw_view(Uint32 ticks) {
+  if ( (overdraw_renderer == NULL)
+      || (nof_uploaded_rects == 0)
+      || (ticks - flash_started_at < OVERDRAW_FLASH_DURATION) )
+    return false;
+
+  nof_uploaded_rects = 0;
+
+  return (current_mode == OVERDRAW_VIEW_UPLOADS)
+    || (current_mode == OVERDRAW_VIEW_BOTH);
+}
+
+
+static void render_heatmap(float x_scale, float y_scale) {
+  int level, row, column, run_start, nof_rects;
+  uint8_t *levels;
+  uint8_t *colour;
+
+  for (level=1; level<=NUMBER_OF_OVERDRAW_LEVELS; level++) {
+    nof_rects = 0;
+
+    // Adjacent tiles of the same level are merged into a single rect.
+    for (row=0; row<displayed_tile_rows; row++) {
+      levels = displayed_levels + row * displayed_tiles_per_row;
+      column = 0;
+      while (column < displayed_tiles_per_row) {
+        if (levels[column] != level) {
+          column++;
+          continue;
+        }
+        run_start = column;
+        while ( (column < displayed_tiles_per_row)
+            && (levels[column] == level) )
+          column++;
+        heatmap_rects[nof_rects].x
+          = (run_start << OVERDRAW_TILE_SHIFT) * x_scale;
+        heatmap_rects[nof_rects].y = (row << OVERDRAW_TILE_SHIFT) * y_scale;
+        heatmap_rects[nof_rects].w
+          = ((column - run_start) << OVERDRAW_TILE_SHIFT) * x_scale;
+        heatmap_rects[nof_rects].h = OVERDRAW_TILE_SIZE * y_scale;
+        nof_rects++;
+      }
+    }
+
+    if (nof_rects > 0) {
+      colour = overdraw_level_colours[level - 1];
+      SDL_SetRenderDrawColor(overdraw_renderer,
+          colour[0], colour[1], colour[2], colour[3]);
+      SDL_RenderFillRectsF(overdraw_renderer, heatmap_rects, nof_rects);
+    }
+  }
+}
+
+
+static void render_uploaded_rects(float x_scale, float y_scale) {
+  SDL_FRect rect;
+  int i;
+
+  for (i=0; i<nof_uploaded_rects; i++) {
+    rect.x = uploaded_rects[i].x * x_scale;
+    rect.y = uploaded_rects[i].y * y_scale;
+    rect.w = uploaded_rects[i].w * x_scale;
+    rect.h = uploaded_rects[i].h * y_scale;
+
+    SDL_SetRenderDrawColor(overdraw_renderer, 0xff, 0x00, 0xff, 0x40);
+    SDL_RenderFillRectF(overdraw_renderer, &rect);
+    SDL_SetRenderDrawColor(overdraw_renderer, 0xff, 0x00, 0xff, 0xff);
+    SDL_RenderDrawRectF(overdraw_renderer, &rect);
+  }
+}
+
+
+void render_overdraw_view(float x_scale, float y_scale) {
+  SDL_BlendMode blend_mode;
+
+  if ( (overdraw_renderer == NULL) || (current_mode == OVERDRAW_VIEW_OFF) )
+    return;
+
+  SDL_GetRenderDrawBlendMode(overdraw_renderer, &blend_mode);
+  SDL_SetRenderDrawBlendMode(overdraw_renderer, SDL_BLENDMODE_BLEND);
+
+  if ( (displayed_levels != NULL)
+      && ( (current_mode == OVERDRAW_VIEW_HEATMAP)
+        || (current_mode == OVERDRAW_VIEW_BOTH) ) )
+    render_heatmap(x_scale, y_scale);
+
+  if ( (current_mode == OVERDRAW_VIEW_UPLOADS)
+      || (current_mode == OVERDRAW_VIEW_BOTH) )
+    render_uploaded_rects(x_scale, y_scale);
+
+  SDL_SetRenderDrawBlendMode(overdraw_renderer, blend_mode);
+}
+
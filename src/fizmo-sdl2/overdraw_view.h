@@ -0,0 +1,106 @@
+/* overdraw_view.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A debug view which shows how often every part of the framebuffer has
+ * been written between two frames, and which parts have been uploaded.
+ * This makes redundant redraws visible, like clearing an area right
+ * before drawing the same contents into it again, and shows how tight
+ * the damage tracking is.
+ *
+ * Every 8x8 tile counts the pixels written into it by draw_rgb_pixel,
+ * fill_area and copy_area. When a frame is presented, the tiles are
+ * shaded by how often each of their pixels has been written on average:
+ * blue for once, green for twice, pink for three times and red for four
+ * or more. Uploaded rectangles are flashed in magenta for a moment.
+ *
+ * The counts are collected by the interpreter thread and handed over to
+ * the main thread at the same time as the damage. The view is drawn
+ * like the other overlays and is not available when presenting via the
+ * window surface. F11 cycles through the modes once the view has been
+ * enabled using the "overdraw-view" option.
+ *
+ */
+
+
+#ifndef overdraw_view_h_INCLUDED
+#define overdraw_view_h_INCLUDED
+
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#define OVERDRAW_TILE_SHIFT 3
+#define OVERDRAW_TILE_SIZE (1 << OVERDRAW_TILE_SHIFT)
+#define OVERDRAW_FLASH_DURATION 250
+
+// Accepts "off", "heatmap", "uploads" or "both", returns -1 for
+// anything else.
+int set_overdraw_view(char *mode_name);
+char *get_overdraw_view();
+
+void init_overdraw_view(SDL_Renderer *renderer);
+void free_overdraw_view();
+
+// Invoked by the interpreter thread whenever the framebuffer has been
+// recreated.
+void init_overdraw_map(int width, int height);
+void count_overdrawn_area(int x, int y, int width, int height);
+
+// The pixel case is inlined since it's run for every pixel libpixelif
+// draws.
+extern bool overdraw_counting_enabled;
+extern uint32_t *overdraw_tiles;
+extern int overdraw_tiles_per_row;
+
+static inline void count_overdrawn_pixel(int x, int y) {
+  if (overdraw_counting_enabled == true)
+    overdraw_tiles[(y >> OVERDRAW_TILE_SHIFT) * overdraw_tiles_per_row
+      + (x >> OVERDRAW_TILE_SHIFT)]++;
+}
+
+// Invoked by the main thread when the damage is collected. Takes over
+// the counts for display and resets them.
+void collect_overdraw_map();
+void overdraw_area_uploaded(SDL_Rect *rect);
+
+// Invoked by the main thread. Returns true in case the mode has changed,
+// or a flash has ended, and the frame has to be presented again.
+bool cycle_overdraw_view();
+bool update_overdraw_view(Uint32 ticks);
+void render_overdraw_view(float x_scale, float y_scale);
+
+#endif // overdraw_view_h_INCLUDED
+
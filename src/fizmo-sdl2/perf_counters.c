@@ -0,0 +1,166 @@
+/* perf_counters.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+
+#include "perf_counters.h"
+#include "lock_profiler.h"
+#include "profile_output.h"
+
+static char *perf_counter_names[NUMBER_OF_PERF_COUNTERS] = {
+  "draw_rgb_pixel_calls",
+  "fill_area_calls",
+  "fill_area_pixels",
+  "copy_area_calls",
+  "copy_area_pixels",
+  "update_screen_requests",
+  "frames_presented",
+  "bytes_uploaded",
+  "events_queued",
+  "events_dequeued",
+  "resizes",
+  "reflows",
+  "timer_firings"
+};
+
+static char *perf_timer_names[NUMBER_OF_PERF_TIMERS] = {
+  "interpreter_turn",
+  "fill_area",
+  "copy_area",
+  "update_screen",
+  "present_frame"
+};
+
+bool perf_counters_enabled = false;
+uint64_t perf_counter_values[NUMBER_OF_PERF_COUNTERS];
+Uint64 perf_timer_ticks[NUMBER_OF_PERF_TIMERS];
+
+static char *counters_report_filename = NULL;
+static Uint64 counters_start_counter;
+
+
+void set_counters_report_filename(char *filename) {
+  free(counters_report_filename);
+  counters_report_filename = filename != NULL ? strdup(filename) : NULL;
+
+  if ( (counters_report_filename != NULL)
+      && (perf_counters_enabled == false) ) {
+    counters_start_counter = SDL_GetPerformanceCounter();
+  }
+  perf_counters_enabled = counters_report_filename != NULL;
+  set_lock_statistics_enabled(perf_counters_enabled);
+}
+
+
+char *get_counters_report_filename() {
+  return counters_report_filename;
+}
+
+
+static long get_peak_rss_kb() {
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif // __APPLE__
+}
+
+
+void write_counters_report() {
+  char filename[PROFILE_FILENAME_BUF_SIZE];
+  unsigned long waits;
+  double total_wait_ms, max_wait_ms;
+  bool first;
+  FILE *out;
+  int i;
+
+  if (counters_report_filename == NULL)
+    return;
+
+  expand_profile_filename(
+      counters_report_filename, filename, PROFILE_FILENAME_BUF_SIZE);
+  if ((out = fopen(filename, "w")) == NULL) {
+    TRACE_LOG("Could not open \"%s\".\n", filename);
+    return;
+  }
+
+  fprintf(out, "{\n  \"pid\": %d,\n  \"wall_time_ms\": %.3f,\n"
+      "  \"peak_rss_kb\": %ld,\n  \"counters\": {",
+      (int)getpid(),
+      profile_ticks_to_ms(SDL_GetPerformanceCounter() - counters_start_counter),
+      get_peak_rss_kb());
+  for (i=0; i<NUMBER_OF_PERF_COUNTERS; i++)
+    fprintf(out, "%s\n    \"%s\": %" PRIu64,
+        i == 0 ? "" : ",", perf_counter_names[i], perf_counter_values[i]);
+
+  fputs("\n  },\n  \"time_ms\": {", out);
+  for (i=0; i<NUMBER_OF_PERF_TIMERS; i++)
+    fprintf(out, "%s\n    \"%s\": %.3f",
+        i == 0 ? "" : ",", perf_timer_names[i],
+        profile_ticks_to_ms(perf_timer_ticks[i]));
+
+  fputs("\n  },\n  \"condition_waits\": {", out);
+  first = true;
+  for (i=0; i<NUMBER_OF_PROFILED_LOCKS; i++) {
+    if (is_profiled_cond(i) == false)
+      continue;
+    get_lock_wait_statistics(i, &waits, &total_wait_ms, &max_wait_ms);
+    fprintf(out, "%s\n    \"%s\": { \"waits\": %lu, \"wait_ms\": %.3f, "
+        "\"max_wait_ms\": %.3f }",
+        first == true ? "" : ",", get_profiled_lock_name(i),
+        waits, total_wait_ms, max_wait_ms);
+    first = false;
+  }
+  fputs("\n  }\n}\n", out);
+
+  fclose(out);
+
+  TRACE_LOG("Wrote counters report to \"%s\".\n", filename);
+}
+
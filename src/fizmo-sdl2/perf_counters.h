@@ -0,0 +1,120 @@
+/* perf_counters.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Counters of the frontend's drawing, presenting, event and resize
+ * activity, which are written to a JSON file once main() returns. This
+ * is meant for comparing runs of a story script between releases, so
+ * the report's keys have to be kept stable: new figures may be added,
+ * but existing ones must not be renamed or change their meaning.
+ *
+ * Counting is only done while a report filename is set. Every counter
+ * is either written by a single thread only, or while holding the lock
+ * which protects the data it counts, so no additional synchronization is
+ * required. The time spent waiting on the condition variables is taken
+ * from the lock profiler.
+ *
+ */
+
+
+#ifndef perf_counters_h_INCLUDED
+#define perf_counters_h_INCLUDED
+
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+enum perf_counter_id {
+  COUNTER_DRAW_RGB_PIXEL_CALLS,
+  COUNTER_FILL_AREA_CALLS,
+  COUNTER_FILL_AREA_PIXELS,
+  COUNTER_COPY_AREA_CALLS,
+  COUNTER_COPY_AREA_PIXELS,
+  COUNTER_UPDATE_SCREEN_REQUESTS,
+  COUNTER_FRAMES_PRESENTED,
+  COUNTER_BYTES_UPLOADED,
+  COUNTER_EVENTS_QUEUED,
+  COUNTER_EVENTS_DEQUEUED,
+  COUNTER_RESIZES,
+  COUNTER_REFLOWS,
+  COUNTER_TIMER_FIRINGS,
+  NUMBER_OF_PERF_COUNTERS
+};
+
+// draw_rgb_pixel is run for every pixel, so it's only counted. Timing it
+// would mostly measure reading the performance counter. The time the
+// interpreter spends between two input requests, which includes drawing,
+// is measured instead.
+enum perf_timer_id {
+  TIMER_INTERPRETER_TURN,
+  TIMER_FILL_AREA,
+  TIMER_COPY_AREA,
+  TIMER_UPDATE_SCREEN,
+  TIMER_PRESENT_FRAME,
+  NUMBER_OF_PERF_TIMERS
+};
+
+// A "%p" in the filename is replaced by the process id when the report
+// is written, so that batch workers and forked sessions don't overwrite
+// each other's reports.
+void set_counters_report_filename(char *filename);
+char *get_counters_report_filename();
+
+// Writes the report in case a filename is set.
+void write_counters_report();
+
+// The counting functions are inlined, so that they cost no more than a
+// branch as long as no report has been requested.
+extern bool perf_counters_enabled;
+extern uint64_t perf_counter_values[NUMBER_OF_PERF_COUNTERS];
+extern Uint64 perf_timer_ticks[NUMBER_OF_PERF_TIMERS];
+
+static inline void add_to_perf_counter(enum perf_counter_id id,
+    uint64_t value) {
+  if (perf_counters_enabled == true)
+    perf_counter_values[id] += value;
+}
+
+static inline Uint64 start_perf_timer() {
+  return perf_counters_enabled == true ? SDL_GetPerformanceCounter() : 0;
+}
+
+static inline void stop_perf_timer(enum perf_timer_id id, Uint64 start) {
+  if (perf_counters_enabled == true)
+    perf_timer_ticks[id] += SDL_GetPerformanceCounter() - start;
+}
+
+#endif // perf_counters_h_INCLUDED
+
@@ -0,0 +1,389 @@
+/* perf_hud.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+
+#include "perf_hud.h"
+
+#define PERF_HUD_GLYPH_WIDTH 5
+#define PERF_HUD_GLYPH_HEIGHT 7
+#define PERF_HUD_LINE_HEIGHT 9
+#define PERF_HUD_PADDING 4
+#define PERF_HUD_MARGIN 8
+#define PERF_HUD_NOF_LINES 6
+#define PERF_HUD_LINE_BUF_SIZE 32
+#define PERF_HUD_GRAPH_FRAMES 128
+#define PERF_HUD_GRAPH_HEIGHT 28
+// The graph's top is at 50 ms, with a line marking 60 frames per second.
+#define PERF_HUD_GRAPH_MAX_US 50000
+#define PERF_HUD_TARGET_FRAME_US 16667
+
+#define PERF_HUD_BACKGROUND 0xc0000000
+#define PERF_HUD_TEXT 0xffffffff
+#define PERF_HUD_TARGET_LINE 0xff808080
+#define PERF_HUD_FAST_FRAME 0xff40d040
+#define PERF_HUD_SLOW_FRAME 0xffe0d040
+#define PERF_HUD_DROPPED_FRAME 0xffe04040
+
+struct presented_frame {
+  Uint64 timestamp;
+  size_t bytes_uploaded;
+};
+
+// Five pixel wide rows, most significant bit leftmost, for the
+// characters in "perf_hud_glyph_chars".
+static char *perf_hud_glyph_chars = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%";
+static uint8_t perf_hud_glyphs[][PERF_HUD_GLYPH_HEIGHT] = {
+  { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },
+  { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },
+  { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },
+  { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },
+  { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },
+  { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },
+  { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },
+  { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+  { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },
+  { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },
+  { 0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11 },
+  { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e },
+  { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e },
+  { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c },
+  { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f },
+  { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 },
+  { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f },
+  { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },
+  { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e },
+  { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c },
+  { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },
+  { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f },
+  { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 },
+  { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+  { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },
+  { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 },
+  { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d },
+  { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 },
+  { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e },
+  { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+  { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },
+  { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 },
+  { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a },
+  { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 },
+  { 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 },
+  { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f },
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c },
+  { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 },
+  { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },
+  { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 },
+  { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }
+};
+
+static SDL_Renderer *hud_renderer = NULL;
+static SDL_Texture *hud_texture = NULL;
+static SDL_Surface *hud_surface = NULL;
+static bool hud_is_visible = false;
+
+// Owned by the main thread.
+static struct presented_frame presented_frames[PERF_HUD_FRAME_HISTORY];
+static int nof_presented_frames = 0;
+static int next_presented_frame = 0;
+static size_t bytes_uploaded_since_present = 0;
+
+// Owned by the interpreter thread.
+static int screen_updates_in_turn = 0;
+static Uint64 blocked_ticks_in_turn = 0;
+static Uint64 resize_started_at = 0;
+
+// Written by the interpreter thread, read by the main thread.
+static SDL_atomic_t screen_updates_in_last_turn;
+static SDL_atomic_t blocked_us_in_last_turn;
+static SDL_atomic_t last_reflow_us;
+static SDL_atomic_t event_queue_depth;
+
+
+void init_perf_hud(SDL_Renderer *renderer) {
+  if (renderer == NULL)
+    return;
+
+  if ((hud_surface = SDL_CreateRGBSurfaceWithFormat(0,
+          PERF_HUD_WIDTH, PERF_HUD_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888))
+      == NULL)
+    return;
+
+  if ((hud_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+          SDL_TEXTUREACCESS_STREAMING, PERF_HUD_WIDTH, PERF_HUD_HEIGHT))
+      == NULL) {
+    TRACE_LOG("Could not create the performance HUD texture.\n");
+    SDL_FreeSurface(hud_surface);
+    hud_surface = NULL;
+    return;
+  }
+
+  SDL_SetTextureBlendMode(hud_texture, SDL_BLENDMODE_BLEND);
+  hud_renderer = renderer;
+}
+
+
+void free_perf_hud() {
+  if (hud_texture != NULL) {
+    SDL_DestroyTexture(hud_texture);
+    hud_texture = NULL;
+  }
+  if (hud_surface != NULL) {
+    SDL_FreeSurface(hud_surface);
+    hud_surface = NULL;
+  }
+  hud_renderer = NULL;
+}
+
+
+void toggle_perf_hud() {
+  hud_is_visible = !hud_is_visible;
+}
+
+
+bool is_perf_hud_visible() {
+  return hud_renderer != NULL && hud_is_visible == true;
+}
+
+
+void perf_hud_bytes_uploaded(size_t bytes) {
+  bytes_uploaded_since_present += bytes;
+}
+
+
+void perf_hud_screen_updated(Uint64 blocked_ticks) {
+  Uint64 now;
+
+  screen_updates_in_turn++;
+  blocked_ticks_in_turn += blocked_ticks;
+
+  // The interpreter is done reflowing after a resize once it asks for
+  // the result to be shown.
+  if (resize_started_at != 0) {
+    now = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&last_reflow_us, (int)((now - resize_started_at) * 1000000
+          / SDL_GetPerformanceFrequency()));
+    resize_started_at = 0;
+  }
+}
+
+
+void perf_hud_turn_finished() {
+  SDL_AtomicSet(&screen_updates_in_last_turn, screen_updates_in_turn);
+  SDL_AtomicSet(&blocked_us_in_last_turn, (int)(blocked_ticks_in_turn
+        * 1000000 / SDL_GetPerformanceFrequency()));
+  screen_updates_in_turn = 0;
+  blocked_ticks_in_turn = 0;
+}
+
+
+void perf_hud_resize_started() {
+  if (resize_started_at == 0)
+    resize_started_at = SDL_GetPerformanceCounter();
+}
+
+
+void perf_hud_event_queue_depth(int depth) {
+  SDL_AtomicSet(&event_queue_depth, depth);
+}
+
+
+static void fill_hud_rect(int x, int y, int width, int height,
+    Uint32 colour) {
+  SDL_Rect rect;
+
+  rect.x = x;
+  rect.y = y;
+  rect.w = width;
+  rect.h = height;
+  SDL_FillRect(hud_surface, &rect, colour);
+}
+
+
+static void draw_hud_text(int x, int y, char *text) {
+  Uint32 *row;
+  char *glyph_char;
+  int glyph_y, glyph_x;
+
+  for (; *text != 0; text++, x += PERF_HUD_GLYPH_WIDTH + 1) {
+    if ( (*text == ' ')
+        || ((glyph_char = strchr(
+              perf_hud_glyph_chars, toupper((unsigned char)*text))) == NULL) )
+      continue;
+    if (x + PERF_HUD_GLYPH_WIDTH > PERF_HUD_WIDTH)
+      return;
+
+    for (glyph_y=0; glyph_y<PERF_HUD_GLYPH_HEIGHT; glyph_y++) {
+      row = (Uint32*)((uint8_t*)hud_surface->pixels
+          + (y + glyph_y) * hud_surface->pitch) + x;
+      for (glyph_x=0; glyph_x<PERF_HUD_GLYPH_WIDTH; glyph_x++)
+        if (perf_hud_glyphs[glyph_char - perf_hud_glyph_chars][glyph_y]
+            & (0x10 >> glyph_x))
+          row[glyph_x] = PERF_HUD_TEXT;
+    }
+  }
+}
+
+
+static struct presented_frame *get_presented_frame(int age) {
+  return &presented_frames[
+    (next_presented_frame - 1 - age + PERF_HUD_FRAME_HISTORY)
+      % PERF_HUD_FRAME_HISTORY];
+}
+
+
+static void draw_frame_time_graph(int x, int y) {
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  Uint64 frame_us;
+  Uint32 colour;
+  int i, height;
+
+  for (i=0; (i < PERF_HUD_GRAPH_FRAMES) && (i < nof_presented_frames - 1);
+      i++) {
+    frame_us
+      = (get_presented_frame(i)->timestamp
+          - get_presented_frame(i + 1)->timestamp)
+      * 1000000 / frequency;
+
+    colour
+      = frame_us <= PERF_HUD_TARGET_FRAME_US + 1000
+      ? PERF_HUD_FAST_FRAME
+      : frame_us <= 2 * PERF_HUD_TARGET_FRAME_US + 1000
+      ? PERF_HUD_SLOW_FRAME
+      : PERF_HUD_DROPPED_FRAME;
+
+    height
+      = frame_us >= PERF_HUD_GRAPH_MAX_US
+      ? PERF_HUD_GRAPH_HEIGHT
+      : (int)(frame_us * PERF_HUD_GRAPH_HEIGHT / PERF_HUD_GRAPH_MAX_US) + 1;
+
+    fill_hud_rect(x + PERF_HUD_GRAPH_FRAMES - 1 - i,
+        y + PERF_HUD_GRAPH_HEIGHT - height, 1, height, colour);
+  }
+
+  fill_hud_rect(x,
+      y + PERF_HUD_GRAPH_HEIGHT - 1
+      - PERF_HUD_TARGET_FRAME_US * PERF_HUD_GRAPH_HEIGHT
+      / PERF_HUD_GRAPH_MAX_US,
+      PERF_HUD_GRAPH_FRAMES, 1, PERF_HUD_TARGET_LINE);
+}
+
+
+static void draw_perf_hud() {
+  char lines[PERF_HUD_NOF_LINES][PERF_HUD_LINE_BUF_SIZE];
+  Uint64 now = get_presented_frame(0)->timestamp;
+  Uint64 frequency = SDL_GetPerformanceFrequency();
+  size_t bytes_uploaded = 0;
+  double last_frame_ms = 0;
+  int i, nof_frames;
+
+  // Rates are averaged over the frames presented during the last second.
+  for (nof_frames=0; nof_frames<nof_presented_frames; nof_frames++) {
+    if (now - get_presented_frame(nof_frames)->timestamp > frequency)
+      break;
+    bytes_uploaded += get_presented_frame(nof_frames)->bytes_uploaded;
+  }
+
+  if (nof_presented_frames > 1)
+    last_frame_ms
+      = (double)(now - get_presented_frame(1)->timestamp) * 1000 / frequency;
+
+  snprintf(lines[0], PERF_HUD_LINE_BUF_SIZE, "FPS %d  FRAME %.1f MS",
+      nof_frames, last_frame_ms);
+  snprintf(lines[1], PERF_HUD_LINE_BUF_SIZE, "UPLOAD %.1f KB/FRAME",
+      nof_frames > 0 ? (double)bytes_uploaded / nof_frames / 1024 : 0.0);
+  snprintf(lines[2], PERF_HUD_LINE_BUF_SIZE, "EVENT QUEUE %d",
+      SDL_AtomicGet(&event_queue_depth));
+  snprintf(lines[3], PERF_HUD_LINE_BUF_SIZE, "UPDATES/TURN %d",
+      SDL_AtomicGet(&screen_updates_in_last_turn));
+  snprintf(lines[4], PERF_HUD_LINE_BUF_SIZE, "BLOCKED %.1f MS/TURN",
+      SDL_AtomicGet(&blocked_us_in_last_turn) / 1000.0);
+  snprintf(lines[5], PERF_HUD_LINE_BUF_SIZE, "REFLOW %.1f MS",
+      SDL_AtomicGet(&last_reflow_us) / 1000.0);
+
+  SDL_FillRect(hud_surface, NULL, PERF_HUD_BACKGROUND);
+  for (i=0; i<PERF_HUD_NOF_LINES; i++)
+    draw_hud_text(PERF_HUD_PADDING,
+        PERF_HUD_PADDING + i * PERF_HUD_LINE_HEIGHT, lines[i]);
+  draw_frame_time_graph(
+      (PERF_HUD_WIDTH - PERF_HUD_GRAPH_FRAMES) / 2,
+      PERF_HUD_HEIGHT - PERF_HUD_PADDING - PERF_HUD_GRAPH_HEIGHT);
+
+  SDL_UpdateTexture(hud_texture, NULL, hud_surface->pixels,
+      hud_surface->pitch);
+}
+
+
+void render_perf_hud() {
+  struct presented_frame *frame;
+  int output_width, output_height, scale;
+  SDL_Rect dest;
+
+  if (hud_renderer == NULL)
+    return;
+
+  // Frames are recorded even while the overlay is hidden, so that it
+  // shows meaningful figures right away.
+  frame = &presented_frames[next_presented_frame];
+  frame->timestamp = SDL_GetPerformanceCounter();
+  frame->bytes_uploaded = bytes_uploaded_since_present;
+  bytes_uploaded_since_present = 0;
+  next_presented_frame = (next_presented_frame + 1) % PERF_HUD_FRAME_HISTORY;
+  if (nof_presented_frames < PERF_HUD_FRAME_HISTORY)
+    nof_presented_frames++;
+
+  if (hud_is_visible == false)
+    return;
+
+  draw_perf_hud();
+
+  // Scaled up in whole steps on high resolution outputs.
+  SDL_GetRendererOutputSize(hud_renderer, &output_width, &output_height);
+  if ((scale = output_height / (PERF_HUD_HEIGHT * 4)) < 1)
+    scale = 1;
+
+  dest.w = PERF_HUD_WIDTH * scale;
+  dest.h = PERF_HUD_HEIGHT * scale;
+  dest.x = output_width - dest.w - PERF_HUD_MARGIN * scale;
+  dest.y = PERF_HUD_MARGIN * scale;
+
+  SDL_RenderCopy(hud_renderer, hud_texture, NULL, &dest);
+}
+
@@ -0,0 +1,80 @@
+/* perf_hud.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ * An on-screen overlay showing live performance figures, which is
+ * toggled using F12: the present rate and a graph of recent frame times,
+ * the amount of texture data uploaded per frame, the depth of the event
+ * queue, how often the interpreter updated the screen during the last
+ * turn and how long it was blocked doing so, and how long the last
+ * resize took until the interpreter had reflowed the screen.
+ *
+ * The overlay is drawn by the main thread after the framebuffer has been
+ * copied to the renderer, so it never ends up in the framebuffer. It's
+ * not available when presenting via the window surface.
+ *
+ */
+
+
+#ifndef perf_hud_h_INCLUDED
+#define perf_hud_h_INCLUDED
+
+#include <stddef.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#define PERF_HUD_FRAME_HISTORY 256
+#define PERF_HUD_WIDTH 160
+#define PERF_HUD_HEIGHT 96
+
+void init_perf_hud(SDL_Renderer *renderer);
+void free_perf_hud();
+
+// Invoked by the main thread.
+void toggle_perf_hud();
+bool is_perf_hud_visible();
+void perf_hud_bytes_uploaded(size_t bytes);
+// To be invoked for every frame, right before SDL_RenderPresent.
+void render_perf_hud();
+
+// Invoked by the interpreter thread.
+void perf_hud_screen_updated(Uint64 blocked_ticks);
+void perf_hud_turn_finished();
+void perf_hud_resize_started();
+
+// May be invoked by any thread.
+void perf_hud_event_queue_depth(int depth);
+
+#endif // perf_hud_h_INCLUDED
+
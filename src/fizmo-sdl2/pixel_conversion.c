@@ -0,0 +1,245 @@
+/* pixel_conversion.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+
+#include <tools/types.h>
+
+#include "pixel_conversion.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PIXEL_CONVERSION_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) \
+  && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define PIXEL_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+
+static void convert_rgb24_to_argb8888_scalar(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  while (nof_pixels-- > 0) {
+    *(dest++)
+      = 0xff000000 | ((uint32_t)src[0] << 16) | ((uint32_t)src[1] << 8)
+      | src[2];
+    src += 3;
+  }
+}
+
+
+static void convert_gray8_to_argb8888_scalar(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  while (nof_pixels-- > 0) {
+    *(dest++) = 0xff000000 | ((uint32_t)*src * 0x010101);
+    src++;
+  }
+}
+
+
+#ifdef PIXEL_CONVERSION_X86
+
+// Every iteration reads 16 bytes but only uses 12 of them, so the loop
+// stops while there are at least 4 bytes left behind the last pixel.
+__attribute__((target("ssse3")))
+static size_t convert_rgb24_to_argb8888_ssse3(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  const __m128i shuffle = _mm_setr_epi8(
+      2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+  size_t i;
+
+  for (i=0; i+6<=nof_pixels; i+=4) {
+    _mm_storeu_si128(
+        (__m128i*)(dest + i),
+        _mm_or_si128(
+          _mm_shuffle_epi8(
+            _mm_loadu_si128((__m128i*)(src + i*3)), shuffle),
+          alpha));
+  }
+
+  return i;
+}
+
+
+// 32-bit builds may not assume SSE2, so this is dispatched at runtime,
+// too.
+__attribute__((target("sse2")))
+static size_t convert_gray8_to_argb8888_sse2(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  const __m128i alpha = _mm_set1_epi8((char)0xff);
+  __m128i gray, gray_gray, gray_alpha;
+  size_t i;
+
+  for (i=0; i+16<=nof_pixels; i+=16) {
+    gray = _mm_loadu_si128((__m128i*)(src + i));
+
+    // Words of "g | g << 8" and "g | 0xff << 8" are interleaved into
+    // "g | g << 8 | g << 16 | 0xff << 24".
+    gray_gray = _mm_unpacklo_epi8(gray, gray);
+    gray_alpha = _mm_unpacklo_epi8(gray, alpha);
+    _mm_storeu_si128((__m128i*)(dest + i),
+        _mm_unpacklo_epi16(gray_gray, gray_alpha));
+    _mm_storeu_si128((__m128i*)(dest + i + 4),
+        _mm_unpackhi_epi16(gray_gray, gray_alpha));
+
+    gray_gray = _mm_unpackhi_epi8(gray, gray);
+    gray_alpha = _mm_unpackhi_epi8(gray, alpha);
+    _mm_storeu_si128((__m128i*)(dest + i + 8),
+        _mm_unpacklo_epi16(gray_gray, gray_alpha));
+    _mm_storeu_si128((__m128i*)(dest + i + 12),
+        _mm_unpackhi_epi16(gray_gray, gray_alpha));
+  }
+
+  return i;
+}
+
+#endif // PIXEL_CONVERSION_X86
+
+
+#ifdef PIXEL_CONVERSION_NEON
+
+static size_t convert_rgb24_to_argb8888_neon(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  uint8x16x3_t rgb;
+  uint8x16x4_t bgra;
+  size_t i;
+
+  bgra.val[3] = vdupq_n_u8(0xff);
+
+  for (i=0; i+16<=nof_pixels; i+=16) {
+    rgb = vld3q_u8(src + i*3);
+    bgra.val[0] = rgb.val[2];
+    bgra.val[1] = rgb.val[1];
+    bgra.val[2] = rgb.val[0];
+    vst4q_u8((uint8_t*)(dest + i), bgra);
+  }
+
+  return i;
+}
+
+
+static size_t convert_gray8_to_argb8888_neon(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  uint8x16x4_t bgra;
+  size_t i;
+
+  bgra.val[3] = vdupq_n_u8(0xff);
+
+  for (i=0; i+16<=nof_pixels; i+=16) {
+    bgra.val[0] = vld1q_u8(src + i);
+    bgra.val[1] = bgra.val[0];
+    bgra.val[2] = bgra.val[0];
+    vst4q_u8((uint8_t*)(dest + i), bgra);
+  }
+
+  return i;
+}
+
+#endif // PIXEL_CONVERSION_NEON
+
+
+void convert_rgb24_to_argb8888(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  size_t done = 0;
+
+#if defined(PIXEL_CONVERSION_X86)
+  if (__builtin_cpu_supports("ssse3"))
+    done = convert_rgb24_to_argb8888_ssse3(src, dest, nof_pixels);
+#elif defined(PIXEL_CONVERSION_NEON)
+  done = convert_rgb24_to_argb8888_neon(src, dest, nof_pixels);
+#endif
+
+  convert_rgb24_to_argb8888_scalar(
+      src + done*3, dest + done, nof_pixels - done);
+}
+
+
+void convert_gray8_to_argb8888(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels) {
+  size_t done = 0;
+
+#if defined(PIXEL_CONVERSION_X86)
+  if (__builtin_cpu_supports("sse2"))
+    done = convert_gray8_to_argb8888_sse2(src, dest, nof_pixels);
+#elif defined(PIXEL_CONVERSION_NEON)
+  done = convert_gray8_to_argb8888_neon(src, dest, nof_pixels);
+#endif
+
+  convert_gray8_to_argb8888_scalar(src + done, dest + done, nof_pixels - done);
+}
+
+
+uint32_t *convert_zimage_to_argb8888(z_image *image) {
+  uint8_t sample_map[256], *samples, *expanded = NULL;
+  size_t nof_pixels, nof_samples, i;
+  uint32_t *pixels;
+  int max_value;
+
+  if ( (image->image_type != DRILBO_IMAGE_TYPE_RGB)
+      && (image->image_type != DRILBO_IMAGE_TYPE_GRAYSCALE) )
+    return NULL;
+
+  nof_pixels = (size_t)image->width * image->height;
+  nof_samples
+    = image->image_type == DRILBO_IMAGE_TYPE_RGB
+    ? nof_pixels * 3
+    : nof_pixels;
+  samples = image->data;
+
+  // Each sample is stored in one byte. Samples narrower than 8 bits are
+  // scaled up to the full range, wider ones have already been reduced to
+  // 8 bits by the decoder.
+  if (image->bits_per_sample < 8) {
+    max_value = (1 << image->bits_per_sample) - 1;
+    for (i=0; i<256; i++)
+      sample_map[i] = i >= (size_t)max_value ? 0xff : i * 255 / max_value;
+
+    expanded = fizmo_malloc(nof_samples);
+    for (i=0; i<nof_samples; i++)
+      expanded[i] = sample_map[samples[i]];
+    samples = expanded;
+  }
+
+  pixels = fizmo_malloc(sizeof(uint32_t) * nof_pixels);
+
+  if (image->image_type == DRILBO_IMAGE_TYPE_RGB)
+    convert_rgb24_to_argb8888(samples, pixels, nof_pixels);
+  else
+    convert_gray8_to_argb8888(samples, pixels, nof_pixels);
+
+  free(expanded);
+
+  return pixels;
+}
+
@@ -0,0 +1,62 @@
+/* pixel_conversion.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Conversion of drilbo image data into packed 32-bit ARGB8888 pixels,
+ * which is the format of all surfaces and textures used by fizmo-sdl2.
+ * The 8-bit RGB and grayscale kernels use SSSE3/SSE2 on x86 and NEON on
+ * ARM when available and fall back to plain C otherwise.
+ *
+ */
+
+
+#ifndef pixel_conversion_h_INCLUDED
+#define pixel_conversion_h_INCLUDED
+
+#include <stddef.h>
+
+#include <tools/types.h>
+#include <drilbo/drilbo.h>
+
+void convert_rgb24_to_argb8888(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels);
+void convert_gray8_to_argb8888(uint8_t *src, uint32_t *dest,
+    size_t nof_pixels);
+
+// Converts a whole RGB or grayscale image, expanding samples which are
+// narrower or wider than 8 bits. Returns a malloced pixel buffer or NULL
+// in case the image type is not supported.
+uint32_t *convert_zimage_to_argb8888(z_image *image);
+
+#endif // pixel_conversion_h_INCLUDED
+
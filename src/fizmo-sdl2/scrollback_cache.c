@@ -0,0 +1,339 @@
+/* scrollback_cache.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <interpreter/fizmo.h>
+
+#include "scrollback_cache.h"
+#include "framebuffer.h"
+
+#define FRAME_HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+#define UNKNOWN_HISTORY_TOP -1
+
+struct scrollback_page {
+  // Page 0 is the live screen, which is kept in the framebuffer's
+  // texture, so only its hash is stored.
+  SDL_Texture *texture;
+  uint64_t hash;
+  bool is_valid;
+};
+
+static int nof_scrollback_pages = DEFAULT_SCROLLBACK_CACHE_PAGES;
+static SDL_Renderer *scrollback_renderer = NULL;
+static struct scrollback_page *scrollback_pages = NULL;
+static int history_top = UNKNOWN_HISTORY_TOP;
+static uint64_t last_frame_hash = 0;
+
+// Number of pages libpixelif has paged back, according to the events
+// consumed by the interpreter thread.
+static SDL_atomic_t interpreter_depth;
+static SDL_atomic_t interpreter_depth_is_unknown;
+
+// While the interpreter remains on the live screen, the main thread may
+// display cached pages by itself.
+static int displayed_depth = 0;
+
+// When the interpreter has been sent off to render an uncached page, the
+// depth it's headed for. The cached page stays displayed until then.
+static int pending_depth = 0;
+
+
+void set_scrollback_cache_size(int nof_pages) {
+  if (scrollback_pages == NULL)
+    nof_scrollback_pages = nof_pages;
+}
+
+
+int get_scrollback_cache_size() {
+  return nof_scrollback_pages;
+}
+
+
+void init_scrollback_cache(SDL_Renderer *renderer) {
+  if ( (nof_scrollback_pages == 0) || (renderer == NULL) )
+    return;
+
+  scrollback_renderer = renderer;
+  scrollback_pages = fizmo_malloc(
+      sizeof(struct scrollback_page) * (nof_scrollback_pages + 1));
+  memset(scrollback_pages, 0,
+      sizeof(struct scrollback_page) * (nof_scrollback_pages + 1));
+  SDL_AtomicSet(&interpreter_depth, 0);
+  SDL_AtomicSet(&interpreter_depth_is_unknown, 0);
+}
+
+
+void invalidate_scrollback_cache() {
+  int i;
+
+  if (scrollback_pages == NULL)
+    return;
+
+  TRACE_LOG("Invalidating scrollback cache.\n");
+
+  for (i=0; i<=nof_scrollback_pages; i++) {
+    if (scrollback_pages[i].texture != NULL) {
+      SDL_DestroyTexture(scrollback_pages[i].texture);
+      scrollback_pages[i].texture = NULL;
+    }
+    scrollback_pages[i].is_valid = false;
+  }
+
+  history_top = UNKNOWN_HISTORY_TOP;
+  displayed_depth = 0;
+  pending_depth = 0;
+}
+
+
+void free_scrollback_cache() {
+  invalidate_scrollback_cache();
+  free(scrollback_pages);
+  scrollback_pages = NULL;
+}
+
+
+static uint64_t hash_frame(SDL_Surface *frame) {
+  uint64_t hash = 0, word;
+  uint8_t *row;
+  size_t row_bytes, i;
+  int y;
+
+  row_bytes = (size_t)frame->w * frame->format->BytesPerPixel;
+
+  for (y=0; y<frame->h; y++) {
+    row = (uint8_t*)frame->pixels + y*frame->pitch;
+    for (i=0; i+8<=row_bytes; i+=8) {
+      memcpy(&word, row + i, 8);
+      hash = (hash ^ word) * FRAME_HASH_MULTIPLIER;
+    }
+    for (; i<row_bytes; i++)
+      hash = (hash ^ row[i]) * FRAME_HASH_MULTIPLIER;
+  }
+
+  return hash;
+}
+
+
+void scrollback_event_consumed(int event_type) {
+  if (scrollback_pages == NULL)
+    return;
+
+  if (event_type == EVENT_WAS_CODE_PAGE_UP) {
+    SDL_AtomicAdd(&interpreter_depth, 1);
+  }
+  else if (event_type == EVENT_WAS_CODE_PAGE_DOWN) {
+    if (SDL_AtomicGet(&interpreter_depth) > 0)
+      SDL_AtomicAdd(&interpreter_depth, -1);
+  }
+  else if ( (event_type == EVENT_WAS_TIMEOUT)
+      || (event_type == EVENT_WAS_WINCH) ) {
+    // Whether these leave the history is up to libpixelif.
+    if (SDL_AtomicGet(&interpreter_depth) > 0)
+      SDL_AtomicSet(&interpreter_depth_is_unknown, 1);
+  }
+  else if (event_type != EVENT_WAS_NOTHING) {
+    // All other input returns libpixelif to the live screen.
+    SDL_AtomicSet(&interpreter_depth, 0);
+    SDL_AtomicSet(&interpreter_depth_is_unknown, 0);
+  }
+}
+
+
+static void store_scrollback_page(int depth, SDL_Surface *framebuffer,
+    uint64_t hash) {
+  struct scrollback_page *page = &scrollback_pages[depth];
+
+  if ( (depth > 0) && (page->texture == NULL) ) {
+    if ((page->texture = SDL_CreateTexture(scrollback_renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            framebuffer->w,
+            framebuffer->h)) == NULL)
+      return;
+  }
+
+  if (depth > 0)
+    upload_framebuffer(page->texture, framebuffer);
+
+  page->hash = hash;
+  page->is_valid = true;
+
+  TRACE_LOG("Stored scrollback page %d.\n", depth);
+}
+
+
+void scrollback_frame_updated(SDL_Surface *framebuffer,
+    int nof_damaged_spans) {
+  int depth;
+  uint64_t hash;
+
+  if (scrollback_pages == NULL)
+    return;
+
+  if (SDL_AtomicGet(&interpreter_depth_is_unknown) != 0) {
+    invalidate_scrollback_cache();
+    return;
+  }
+
+  depth = SDL_AtomicGet(&interpreter_depth);
+
+  if ( (depth == 0) && (scrollback_pages[0].is_valid == false) ) {
+    // Nothing to compare the live screen to, so hashing can be skipped.
+    displayed_depth = 0;
+    return;
+  }
+
+  if (nof_damaged_spans > 0)
+    last_frame_hash = hash_frame(framebuffer);
+  hash = last_frame_hash;
+
+  if (depth > nof_scrollback_pages) {
+    // Too deep to be cached, but the interpreter may still have arrived.
+  }
+  else if (scrollback_pages[depth].is_valid == true) {
+    if (scrollback_pages[depth].hash != hash) {
+      // For the live screen this means new output, otherwise libpixelif
+      // isn't where it's supposed to be.
+      if (depth > 0)
+        SDL_AtomicSet(&interpreter_depth_is_unknown, 1);
+      invalidate_scrollback_cache();
+    }
+  }
+  else if ( (depth > 0)
+      && (scrollback_pages[depth - 1].is_valid == true)
+      && (scrollback_pages[depth - 1].hash == hash) ) {
+    // The last page up didn't move, so the history's top was reached.
+    history_top = depth - 1;
+    SDL_AtomicAdd(&interpreter_depth, -1);
+    if (pending_depth > 0) {
+      // The page asked for doesn't exist, the top is shown instead.
+      pending_depth = 0;
+      displayed_depth = 0;
+    }
+  }
+  else {
+    store_scrollback_page(depth, framebuffer, hash);
+  }
+
+  if ( (pending_depth > 0)
+      && (SDL_AtomicGet(&interpreter_depth) == pending_depth) ) {
+    // The interpreter has caught up, its frames are shown from now on.
+    pending_depth = 0;
+    displayed_depth = 0;
+  }
+}
+
+
+int scrollback_page_up(SDL_Surface *presented_frame,
+    bool interpreter_is_idle) {
+  int result;
+
+  if ( (scrollback_pages == NULL)
+      || (SDL_AtomicGet(&interpreter_depth_is_unknown) != 0) )
+    return 1;
+
+  if (pending_depth > 0) {
+    pending_depth++;
+    return 1;
+  }
+
+  if (displayed_depth == 0) {
+    if ( (interpreter_is_idle == false)
+        || (SDL_AtomicGet(&interpreter_depth) != 0) )
+      return 1;
+
+    if (scrollback_pages[0].is_valid == false) {
+      // Leaving the live screen for the first time, remember what it
+      // looks like.
+      last_frame_hash = hash_frame(presented_frame);
+      store_scrollback_page(0, presented_frame, last_frame_hash);
+    }
+  }
+
+  if (displayed_depth == history_top)
+    return 0;
+
+  if ( (displayed_depth < nof_scrollback_pages)
+      && (scrollback_pages[displayed_depth + 1].is_valid == true) ) {
+    displayed_depth++;
+    return 0;
+  }
+
+  // The interpreter has to render the next page itself, starting from the
+  // live screen. The cached page remains displayed meanwhile.
+  result = displayed_depth + 1;
+  if (displayed_depth > 0)
+    pending_depth = result;
+  return result;
+}
+
+
+int scrollback_page_down() {
+  if (pending_depth > 0) {
+    // The interpreter is sent one page less far. Should it end up on the
+    // live screen, there's nothing to wait for.
+    if (--pending_depth == 0)
+      displayed_depth = 0;
+    return 1;
+  }
+
+  if (displayed_depth == 0)
+    return 1;
+
+  displayed_depth--;
+  return 0;
+}
+
+
+bool leave_scrollback_pages() {
+  if (displayed_depth == 0)
+    return false;
+
+  displayed_depth = 0;
+  pending_depth = 0;
+  return true;
+}
+
+
+SDL_Texture *get_displayed_scrollback_page() {
+  return scrollback_pages != NULL && displayed_depth > 0
+    ? scrollback_pages[displayed_depth].texture
+    : NULL;
+}
+
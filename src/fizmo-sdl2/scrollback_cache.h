@@ -0,0 +1,91 @@
+/* scrollback_cache.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Keeps the pages libpixelif has rendered while paging back through the
+ * story's history as textures. Once the interpreter has returned to the
+ * live screen, paging over these pages again is done by the main thread
+ * alone, without libpixelif re-rasterizing any history text.
+ *
+ * Since libpixelif doesn't tell which history position it's showing, it's
+ * derived from the paging events the interpreter has consumed. Each page
+ * is stored with a hash of its contents, which detects reaching the top
+ * of the history as well as any disagreement about the position. In the
+ * latter case the cache stays unused until other input brings libpixelif
+ * back to the live screen.
+ *
+ */
+
+
+#ifndef scrollback_cache_h_INCLUDED
+#define scrollback_cache_h_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+#define DEFAULT_SCROLLBACK_CACHE_PAGES 8
+
+void set_scrollback_cache_size(int nof_pages);
+int get_scrollback_cache_size();
+
+void init_scrollback_cache(SDL_Renderer *renderer);
+void free_scrollback_cache();
+
+// To be invoked when the screen's size or fonts change.
+void invalidate_scrollback_cache();
+
+// Invoked by the interpreter thread for every event it takes from the
+// event queue.
+void scrollback_event_consumed(int event_type);
+
+// Invoked by the main thread for every frame libpixelif has drawn, while
+// the interpreter is waiting for the update to finish.
+void scrollback_frame_updated(SDL_Surface *framebuffer, int nof_damaged_spans);
+
+// Key handling, invoked by the main thread. "presented_frame" is a copy
+// of what's on the screen, "interpreter_is_idle" tells whether all queued
+// events have been consumed. The functions return how many page up or
+// down events still have to be passed on to the interpreter.
+int scrollback_page_up(SDL_Surface *presented_frame, bool interpreter_is_idle);
+int scrollback_page_down();
+
+// Returns true in case a cached page was displayed and the live screen
+// has to be presented again, since other input has arrived.
+bool leave_scrollback_pages();
+
+// Returns the cached page to display instead of the framebuffer, or NULL.
+SDL_Texture *get_displayed_scrollback_page();
+
+#endif // scrollback_cache_h_INCLUDED
+
@@ -0,0 +1,1615 @@
+/* sdl2_sound.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <SDL2/SDL.h>
+
+#ifdef ENABLE_OGG_VORBIS
+#include <vorbis/vorbisfile.h>
+#endif // ENABLE_OGG_VORBIS
+
+#ifdef ENABLE_MODPLUG
+#include <libmodplug/modplug.h>
+#endif // ENABLE_MODPLUG
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+#include <tools/unused.h>
+#include <tools/filesys.h>
+#include <interpreter/config.h>
+#include <sound_interface/sound_interface.h>
+
+#include "mmap_filesys.h"
+#include "blorb_index.h"
+#include "sound_mixer.h"
+#include "sound_resampler.h"
+#include "sdl2_sound.h"
+
+#define SDL2_SOUND_INTERFACE_NAME "sdl2-sound"
+#define SDL2_SOUND_INTERFACE_VERSION "0.1.0"
+
+#define SOUND_DEVICE_FREQUENCY 44100
+// Must be a power of two. At 44.1 kHz, the ring holds about 190 ms.
+#define SOUND_RING_FRAMES 8192
+#define SOUND_RING_MASK (SOUND_RING_FRAMES - 1)
+// Number of source frames decoded in one go.
+#define SOUND_DECODE_FRAMES 1024
+// Effects replace each other, as do looping background sounds and music,
+// but one sound of each kind may play at the same time.
+#define SOUND_VOICE_EFFECT 0
+#define SOUND_VOICE_BACKGROUND 1
+#define NUMBER_OF_SOUND_VOICES 2
+// How long the worker sleeps while the ring is full, in milliseconds.
+#define SOUND_WORKER_POLL_INTERVAL 20
+// A single sound may occupy at most this fraction of the cache.
+#define SOUND_CACHE_ENTRY_DIVISOR 4
+#define UNMIXED_GAIN -1.0f
+#define BLEEP_DURATION 100
+#define BLEEP_AMPLITUDE 6000
+#define CONFIG_VALUE_BUF_SIZE 16
+#define SOUND_BENCHMARK_CALLBACKS 2000
+#define SOUND_BENCHMARK_MAX_VOICES 8
+#define SOUND_BENCHMARK_SECONDS 10
+// Infocom sound files are named after the first six characters of the
+// story file's name, followed by the two-digit sound number.
+#define INFOCOM_SOUND_NAME_LENGTH 6
+#define INFOCOM_SOUND_HEADER_SIZE 10
+
+enum sound_request_type {
+  SOUND_REQUEST_PREPARE,
+  SOUND_REQUEST_PLAY,
+  SOUND_REQUEST_STOP,
+  SOUND_REQUEST_UNLOAD
+};
+
+struct sound_request {
+  enum sound_request_type type;
+  int number;
+  int volume;
+  int repeats;
+  struct sound_request *next;
+};
+
+struct sound_resource {
+  z_file *in;
+  uint8_t *data;
+  size_t size;
+  // Only set in case the resource could not be mapped and was read.
+  uint8_t *buffer;
+};
+
+struct cached_sound {
+  int number;
+  int rate;
+  long nof_frames;
+  int16_t *frames;
+  // Most recently used entries come first.
+  struct cached_sound *prev;
+  struct cached_sound *next;
+};
+
+// Decoders deliver interleaved 16-bit stereo frames at the source's rate.
+struct sound_decoder {
+  int rate;
+  // Negative in case the length isn't known in advance.
+  long total_frames;
+  struct sound_resource resource;
+  long (*decode)(struct sound_decoder *decoder, int16_t *frames,
+      long max_frames);
+  bool (*rewind)(struct sound_decoder *decoder);
+  void (*close)(struct sound_decoder *decoder);
+  // Used by the AIFF and cache decoders.
+  const uint8_t *samples;
+  int channels;
+  int bytes_per_sample;
+  long position;
+  struct cached_sound *cached;
+  // Used by the library-backed decoders.
+  void *state;
+  // Music is played as a background sound regardless of its repeats.
+  bool is_music;
+};
+
+// A ring is written by the worker and read by the audio callback. The
+// counters are free-running frame counts, only their differences matter.
+// Frames before "flush_count" belong to a stopped sound, they're faded
+// out and skipped by the callback.
+struct voice_ring {
+  int16_t frames[2 * SOUND_RING_FRAMES];
+  SDL_atomic_t write_count;
+  SDL_atomic_t read_count;
+  SDL_atomic_t flush_count;
+  // Volume of the voice's sound, 256 being the loudest.
+  SDL_atomic_t gain;
+  // Owned by the callback, the gain the latest frames were mixed with,
+  // or UNMIXED_GAIN in case the ring ran empty.
+  float mixed_gain;
+};
+
+struct sound_voice {
+  bool is_active;
+  int number;
+  // Negative means the sound is repeated until stopped.
+  int repeats_left;
+  bool input_finished;
+  struct sound_decoder decoder;
+  struct sound_resampler resampler;
+  struct voice_ring *ring;
+};
+
+static char *config_option_names[] = {
+  "sound-buffer-samples", "sound-cache-size", NULL };
+static char config_value_buf[CONFIG_VALUE_BUF_SIZE];
+
+static int sound_buffer_samples = DEFAULT_SOUND_BUFFER_SAMPLES;
+static size_t sound_cache_size = DEFAULT_SOUND_CACHE_SIZE * 1024;
+static bool sound_disabled = false;
+
+static SDL_AudioDeviceID sound_device = 0;
+static int device_frequency = SOUND_DEVICE_FREQUENCY;
+static bool output_8bit = false;
+static float *sound_mix = NULL;
+static int sound_mix_frames = 0;
+
+static SDL_Thread *sound_worker_thread = NULL;
+static SDL_mutex *sound_request_mutex = NULL;
+static SDL_cond *sound_request_cond = NULL;
+static struct sound_request *first_request = NULL;
+static struct sound_request *last_request = NULL;
+static bool sound_worker_should_stop = false;
+
+// Directory and shortened name of the story file, used to locate Infocom
+// sound files, and the offset of the name within.
+static char *infocom_sound_prefix = NULL;
+static size_t infocom_sound_name_offset = 0;
+
+static struct voice_ring voice_rings[NUMBER_OF_SOUND_VOICES];
+
+// Owned by the worker thread.
+static struct sound_voice voices[NUMBER_OF_SOUND_VOICES];
+static struct cached_sound *first_cached_sound = NULL;
+static struct cached_sound *last_cached_sound = NULL;
+static size_t cached_sounds_size = 0;
+
+
+static uint32_t read_be32(const uint8_t *data) {
+  return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16)
+    | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+
+static uint16_t read_be16(const uint8_t *data) {
+  return ((uint16_t)data[0] << 8) | (uint16_t)data[1];
+}
+
+
+// --- Mixing, done by the audio callback
+
+
+// Volume changes are ramped across the frames mixed, and a stopped
+// sound's remaining frames are faded out. Sounds start at their volume
+// right away.
+static void mix_voice_ring(struct voice_ring *ring, float *mix,
+    int nof_frames) {
+  uint32_t read = (uint32_t)SDL_AtomicGet(&ring->read_count);
+  uint32_t end = (uint32_t)SDL_AtomicGet(&ring->write_count);
+  uint32_t flush = (uint32_t)SDL_AtomicGet(&ring->flush_count);
+  float gain = SDL_AtomicGet(&ring->gain) / 256.0f, gain_step;
+  bool is_flushing = false;
+  int available, first_part;
+
+  if ((int32_t)(flush - read) > 0) {
+    end = flush;
+    gain = 0;
+    is_flushing = true;
+  }
+
+  available = (int32_t)(end - read);
+  if (available > nof_frames)
+    available = nof_frames;
+
+  if (available > 0) {
+    if (ring->mixed_gain == UNMIXED_GAIN)
+      ring->mixed_gain = gain;
+    gain_step = (gain - ring->mixed_gain) / available;
+    first_part = SOUND_RING_FRAMES - (read & SOUND_RING_MASK);
+    if (first_part > available)
+      first_part = available;
+
+    mix_sound_frames(mix, ring->frames + (read & SOUND_RING_MASK) * 2,
+        first_part, ring->mixed_gain, gain_step);
+    if (available > first_part) {
+      mix_sound_frames(mix + first_part * 2, ring->frames,
+          available - first_part, ring->mixed_gain + first_part * gain_step,
+          gain_step);
+    }
+  }
+
+  ring->mixed_gain
+    = (available > 0) && (is_flushing == false) ? gain : UNMIXED_GAIN;
+  SDL_AtomicSet(&ring->read_count,
+      (int)(is_flushing == true ? flush : read + available));
+}
+
+
+static void mix_voice_rings(struct voice_ring *rings, int nof_rings,
+    Uint8 *stream, int nof_frames) {
+  int i;
+
+  clear_sound_mix(sound_mix, nof_frames);
+  for (i=0; i<nof_rings; i++)
+    mix_voice_ring(&rings[i], sound_mix, nof_frames);
+
+  if (output_8bit == true)
+    convert_sound_mix_to_s8(sound_mix, (int8_t*)stream, nof_frames);
+  else
+    convert_sound_mix_to_s16(sound_mix, (int16_t*)stream, nof_frames);
+}
+
+
+static void audio_callback(void *UNUSED(userdata), Uint8 *stream, int len) {
+  int frame_size = output_8bit == true ? 2 : 4;
+  int nof_frames = len / frame_size, chunk;
+
+  while (nof_frames > 0) {
+    chunk = nof_frames < sound_mix_frames ? nof_frames : sound_mix_frames;
+    mix_voice_rings(voice_rings, NUMBER_OF_SOUND_VOICES, stream, chunk);
+    stream += chunk * frame_size;
+    nof_frames -= chunk;
+  }
+}
+
+
+// --- Resources
+
+
+static bool load_sound_resource(blorb_index_entry *entry,
+    struct sound_resource *resource) {
+  char *blorb_filename;
+  uint8_t *mapped_data;
+  size_t mapped_size;
+
+  if ((blorb_filename = get_blorb_index_filename()) == NULL)
+    return false;
+
+  if ((resource->in = fsi->openfile(
+          blorb_filename, FILETYPE_DATA, FILEACCESS_READ)) == NULL)
+    return false;
+
+  resource->buffer = NULL;
+  resource->size = entry->length;
+
+  if ((mapped_data = get_mapped_file_data(resource->in, &mapped_size))
+      != NULL) {
+    if ( (entry->offset > mapped_size)
+        || (entry->length > mapped_size - entry->offset) ) {
+      fsi->closefile(resource->in);
+      return false;
+    }
+    resource->data = mapped_data + entry->offset;
+    return true;
+  }
+
+  resource->buffer = fizmo_malloc(entry->length);
+  if ( (fsi->setfilepos(resource->in, entry->offset, SEEK_SET) != 0)
+      || (fsi->readchars(resource->buffer, entry->length, resource->in)
+        != entry->length) ) {
+    free(resource->buffer);
+    fsi->closefile(resource->in);
+    return false;
+  }
+  resource->data = resource->buffer;
+
+  return true;
+}
+
+
+// Tries the name as derived from the story file, then in uppercase and in
+// lowercase, the way the files are found on old Infocom disks and on the
+// IF-archive.
+static bool load_infocom_sound_file(int number,
+    struct sound_resource *resource) {
+  char *filename;
+  size_t len, i;
+  long size;
+  int variant;
+
+  if ( (infocom_sound_prefix == NULL) || (number < 0) || (number > 99) )
+    return false;
+
+  len = strlen(infocom_sound_prefix) + 7;
+  filename = fizmo_malloc(len);
+  resource->in = NULL;
+
+  for (variant=0; (variant<3) && (resource->in == NULL); variant++) {
+    snprintf(filename, len, "%s%02d.snd", infocom_sound_prefix, number);
+    for (i=infocom_sound_name_offset; filename[i] != 0; i++) {
+      if (variant == 1)
+        filename[i] = toupper((unsigned char)filename[i]);
+      else if (variant == 2)
+        filename[i] = tolower((unsigned char)filename[i]);
+    }
+    resource->in = fsi->openfile(filename, FILETYPE_DATA, FILEACCESS_READ);
+  }
+
+  if (resource->in == NULL) {
+    free(filename);
+    return false;
+  }
+
+  TRACE_LOG("Using sound file \"%s\".\n", filename);
+  free(filename);
+
+  resource->buffer = NULL;
+
+  if ((resource->data = get_mapped_file_data(resource->in, &resource->size))
+      != NULL)
+    return true;
+
+  if ( (fsi->setfilepos(resource->in, 0, SEEK_END) != 0)
+      || ((size = fsi->getfilepos(resource->in)) < 0)
+      || (fsi->setfilepos(resource->in, 0, SEEK_SET) != 0) ) {
+    fsi->closefile(resource->in);
+    return false;
+  }
+
+  resource->size = size;
+  resource->buffer = fizmo_malloc(size + 1);
+  if (fsi->readchars(resource->buffer, size, resource->in) != (size_t)size) {
+    free(resource->buffer);
+    fsi->closefile(resource->in);
+    return false;
+  }
+  resource->data = resource->buffer;
+
+  return true;
+}
+
+
+static void release_sound_resource(struct sound_resource *resource) {
+  if (resource->in == NULL)
+    return;
+  free(resource->buffer);
+  fsi->closefile(resource->in);
+  resource->in = NULL;
+}
+
+
+// --- Decoders
+
+
+static long decode_cached_sound(struct sound_decoder *decoder,
+    int16_t *frames, long max_frames) {
+  long nof_frames = decoder->cached->nof_frames - decoder->position;
+
+  if (nof_frames > max_frames)
+    nof_frames = max_frames;
+
+  memcpy(frames, decoder->cached->frames + decoder->position * 2,
+      nof_frames * 4);
+  decoder->position += nof_frames;
+
+  return nof_frames;
+}
+
+
+static bool rewind_position(struct sound_decoder *decoder) {
+  decoder->position = 0;
+  return true;
+}
+
+
+static void close_cached_sound_decoder(struct sound_decoder *decoder) {
+  decoder->cached = NULL;
+}
+
+
+static void open_cached_sound_decoder(struct sound_decoder *decoder,
+    struct cached_sound *cached) {
+  memset(decoder, 0, sizeof(struct sound_decoder));
+  decoder->rate = cached->rate;
+  decoder->total_frames = cached->nof_frames;
+  decoder->decode = &decode_cached_sound;
+  decoder->rewind = &rewind_position;
+  decoder->close = &close_cached_sound_decoder;
+  decoder->cached = cached;
+}
+
+
+// Only the most significant 16 bits of each sample are used, and only
+// the first two channels.
+static long decode_aiff(struct sound_decoder *decoder, int16_t *frames,
+    long max_frames) {
+  long nof_frames = decoder->total_frames - decoder->position;
+  int frame_size = decoder->bytes_per_sample * decoder->channels;
+  const uint8_t *src = decoder->samples + decoder->position * frame_size;
+  int second_channel = decoder->channels > 1 ? decoder->bytes_per_sample : 0;
+  long i;
+
+  if (nof_frames > max_frames)
+    nof_frames = max_frames;
+
+  for (i=0; i<nof_frames; i++) {
+    if (decoder->bytes_per_sample == 1) {
+      frames[i * 2] = (int16_t)((int8_t)src[0] * 256);
+      frames[i * 2 + 1] = (int16_t)((int8_t)src[second_channel] * 256);
+    }
+    else {
+      frames[i * 2] = (int16_t)read_be16(src);
+      frames[i * 2 + 1] = (int16_t)read_be16(src + second_channel);
+    }
+    src += frame_size;
+  }
+
+  decoder->position += nof_frames;
+
+  return nof_frames;
+}
+
+
+static void close_aiff_decoder(struct sound_decoder *decoder) {
+  release_sound_resource(&decoder->resource);
+}
+
+
+// The sample rate is stored as an 80-bit IEEE 754 extended precision
+// number. Returns 0 for rates which aren't positive integers.
+static int read_aiff_sample_rate(const uint8_t *data) {
+  int exponent = (((data[0] & 0x7f) << 8) | data[1]) - 16383;
+  uint64_t mantissa
+    = ((uint64_t)read_be32(data + 2) << 32) | read_be32(data + 6);
+
+  if ( ((data[0] & 0x80) != 0) || (exponent < 0) || (exponent > 30) )
+    return 0;
+
+  return (int)(mantissa >> (63 - exponent));
+}
+
+
+static bool open_aiff_decoder(struct sound_decoder *decoder) {
+  const uint8_t *data = decoder->resource.data;
+  size_t size = decoder->resource.size, pos = 4, samples_size = 0;
+  uint32_t chunk_len, ssnd_offset;
+  long nof_frames = 0;
+  int bits = 0;
+
+  if ( (size < 4) || (memcmp(data, "AIFF", 4) != 0) )
+    return false;
+
+  decoder->samples = NULL;
+
+  while (pos + 8 <= size) {
+    chunk_len = read_be32(data + pos + 4);
+    if (chunk_len > size - pos - 8)
+      chunk_len = size - pos - 8;
+
+    if ( (memcmp(data + pos, "COMM", 4) == 0) && (chunk_len >= 18) ) {
+      decoder->channels = read_be16(data + pos + 8);
+      nof_frames = read_be32(data + pos + 10);
+      bits = read_be16(data + pos + 14);
+      decoder->rate = read_aiff_sample_rate(data + pos + 16);
+    }
+    else if ( (memcmp(data + pos, "SSND", 4) == 0) && (chunk_len >= 8) ) {
+      ssnd_offset = read_be32(data + pos + 8);
+      if (ssnd_offset <= chunk_len - 8) {
+        decoder->samples = data + pos + 16 + ssnd_offset;
+        samples_size = chunk_len - 8 - ssnd_offset;
+      }
+    }
+
+    pos += 8 + chunk_len + (chunk_len & 1);
+  }
+
+  if ( (decoder->samples == NULL) || (decoder->channels < 1)
+      || (bits < 1) || (bits > 32) || (decoder->rate <= 0) )
+    return false;
+
+  decoder->bytes_per_sample = (bits + 7) / 8;
+  if ((size_t)nof_frames
+      > samples_size / (decoder->bytes_per_sample * decoder->channels))
+    nof_frames = samples_size / (decoder->bytes_per_sample * decoder->channels);
+
+  decoder->total_frames = nof_frames;
+  decoder->position = 0;
+  decoder->decode = &decode_aiff;
+  decoder->rewind = &rewind_position;
+  decoder->close = &close_aiff_decoder;
+
+  return true;
+}
+
+
+// Infocom sound files consist of a ten byte header, holding the sample
+// rate at offset 4 and the number of samples at offset 8, followed by
+// unsigned 8-bit mono samples.
+static long decode_infocom_sound(struct sound_decoder *decoder,
+    int16_t *frames, long max_frames) {
+  long nof_frames = decoder->total_frames - decoder->position;
+  const uint8_t *src = decoder->samples + decoder->position;
+  long i;
+
+  if (nof_frames > max_frames)
+    nof_frames = max_frames;
+
+  for (i=0; i<nof_frames; i++) {
+    frames[i * 2] = (int16_t)(((int)src[i] - 128) * 256);
+    frames[i * 2 + 1] = frames[i * 2];
+  }
+
+  decoder->position += nof_frames;
+
+  return nof_frames;
+}
+
+
+static bool open_infocom_sound_decoder(struct sound_decoder *decoder) {
+  const uint8_t *data = decoder->resource.data;
+  size_t size = decoder->resource.size;
+  long nof_frames;
+
+  if (size < INFOCOM_SOUND_HEADER_SIZE)
+    return false;
+
+  decoder->rate = read_be16(data + 4);
+  nof_frames = read_be16(data + 8);
+  if ((size_t)nof_frames > size - INFOCOM_SOUND_HEADER_SIZE)
+    nof_frames = size - INFOCOM_SOUND_HEADER_SIZE;
+
+  if ( (decoder->rate <= 0) || (nof_frames <= 0) )
+    return false;
+
+  decoder->samples = data + INFOCOM_SOUND_HEADER_SIZE;
+  decoder->channels = 1;
+  decoder->bytes_per_sample = 1;
+  decoder->total_frames = nof_frames;
+  decoder->position = 0;
+  decoder->decode = &decode_infocom_sound;
+  decoder->rewind = &rewind_position;
+  decoder->close = &close_aiff_decoder;
+
+  return true;
+}
+
+
+#ifdef ENABLE_OGG_VORBIS
+struct vorbis_state {
+  OggVorbis_File file;
+  const uint8_t *data;
+  size_t size;
+  size_t pos;
+  int16_t buffer[2 * SOUND_DECODE_FRAMES];
+};
+
+
+static size_t read_vorbis_data(void *ptr, size_t size, size_t nmemb,
+    void *datasource) {
+  struct vorbis_state *state = datasource;
+  size_t len = size * nmemb;
+
+  if (len > state->size - state->pos)
+    len = state->size - state->pos;
+  memcpy(ptr, state->data + state->pos, len);
+  state->pos += len;
+
+  return size > 0 ? len / size : 0;
+}
+
+
+static int seek_vorbis_data(void *datasource, ogg_int64_t offset,
+    int whence) {
+  struct vorbis_state *state = datasource;
+
+  if (whence == SEEK_CUR)
+    offset += state->pos;
+  else if (whence == SEEK_END)
+    offset += state->size;
+  else if (whence != SEEK_SET)
+    return -1;
+
+  if ( (offset < 0) || ((size_t)offset > state->size) )
+    return -1;
+
+  state->pos = offset;
+  return 0;
+}
+
+
+static long tell_vorbis_data(void *datasource) {
+  return ((struct vorbis_state*)datasource)->pos;
+}
+
+
+static long decode_vorbis(struct sound_decoder *decoder, int16_t *frames,
+    long max_frames) {
+  struct vorbis_state *state = decoder->state;
+  long nof_frames = 0, nof_read, nof_wanted, i;
+  vorbis_info *info;
+  int bitstream, channels;
+
+  while (nof_frames < max_frames) {
+    // The channel count may change between logical bitstreams.
+    if ((info = ov_info(&state->file, -1)) == NULL)
+      break;
+    channels = info->channels;
+    nof_wanted = max_frames - nof_frames;
+    if (nof_wanted > 2 * SOUND_DECODE_FRAMES / channels)
+      nof_wanted = 2 * SOUND_DECODE_FRAMES / channels;
+    nof_read = ov_read(&state->file, (char*)state->buffer,
+        nof_wanted * channels * sizeof(int16_t), 0, 2, 1, &bitstream);
+    if (nof_read == OV_HOLE)
+      continue;
+    if (nof_read <= 0)
+      break;
+    nof_read /= sizeof(int16_t) * channels;
+    for (i=0; i<nof_read; i++) {
+      frames[(nof_frames + i) * 2] = state->buffer[i * channels];
+      frames[(nof_frames + i) * 2 + 1]
+        = state->buffer[i * channels + (channels > 1 ? 1 : 0)];
+    }
+    nof_frames += nof_read;
+  }
+
+  return nof_frames;
+}
+
+
+static bool rewind_vorbis(struct sound_decoder *decoder) {
+  return ov_pcm_seek(&((struct vorbis_state*)decoder->state)->file, 0) == 0;
+}
+
+
+static void close_vorbis_decoder(struct sound_decoder *decoder) {
+  ov_clear(&((struct vorbis_state*)decoder->state)->file);
+  free(decoder->state);
+  release_sound_resource(&decoder->resource);
+}
+
+
+static bool open_vorbis_decoder(struct sound_decoder *decoder) {
+  ov_callbacks callbacks = {
+    &read_vorbis_data, &seek_vorbis_data, NULL, &tell_vorbis_data };
+  struct vorbis_state *state = fizmo_malloc(sizeof(struct vorbis_state));
+  vorbis_info *info;
+  ogg_int64_t total;
+
+  state->data = decoder->resource.data;
+  state->size = decoder->resource.size;
+  state->pos = 0;
+
+  if (ov_open_callbacks(state, &state->file, NULL, 0, callbacks) != 0) {
+    free(state);
+    return false;
+  }
+
+  if ((info = ov_info(&state->file, -1)) == NULL) {
+    ov_clear(&state->file);
+    free(state);
+    return false;
+  }
+
+  total = ov_pcm_total(&state->file, -1);
+  decoder->rate = info->rate;
+  decoder->total_frames = total >= 0 ? (long)total : -1;
+  decoder->state = state;
+  decoder->decode = &decode_vorbis;
+  decoder->rewind = &rewind_vorbis;
+  decoder->close = &close_vorbis_decoder;
+
+  return true;
+}
+#endif // ENABLE_OGG_VORBIS
+
+
+#ifdef ENABLE_MODPLUG
+static long decode_mod(struct sound_decoder *decoder, int16_t *frames,
+    long max_frames) {
+  int nof_bytes = ModPlug_Read(decoder->state, frames, max_frames * 4);
+  return nof_bytes > 0 ? nof_bytes / 4 : 0;
+}
+
+
+static bool rewind_mod(struct sound_decoder *decoder) {
+  ModPlug_Seek(decoder->state, 0);
+  return true;
+}
+
+
+static void close_mod_decoder(struct sound_decoder *decoder) {
+  ModPlug_Unload(decoder->state);
+}
+
+
+// Modules are rendered at the device's rate right away. Since libmodplug
+// copies the module data, the resource can be released after loading.
+static bool open_mod_decoder(struct sound_decoder *decoder) {
+  ModPlug_Settings settings;
+
+  ModPlug_GetSettings(&settings);
+  settings.mChannels = 2;
+  settings.mBits = 16;
+  settings.mFrequency = device_frequency;
+  settings.mLoopCount = 0;
+  ModPlug_SetSettings(&settings);
+
+  decoder->state = ModPlug_Load(decoder->resource.data, decoder->resource.size);
+  release_sound_resource(&decoder->resource);
+
+  if (decoder->state == NULL)
+    return false;
+
+  decoder->rate = device_frequency;
+  decoder->total_frames = -1;
+  decoder->decode = &decode_mod;
+  decoder->rewind = &rewind_mod;
+  decoder->close = &close_mod_decoder;
+  decoder->is_music = true;
+
+  return true;
+}
+#endif // ENABLE_MODPLUG
+
+
+static bool open_sound_decoder(int number, struct sound_decoder *decoder) {
+  blorb_index_entry *entry;
+  bool result = false;
+
+  memset(decoder, 0, sizeof(struct sound_decoder));
+
+  if ((entry = get_blorb_index_entry(BLORB_INDEX_USAGE_SOUND, number))
+      == NULL) {
+    if (load_infocom_sound_file(number, &decoder->resource) == false) {
+      TRACE_LOG("No sound resource %d.\n", number);
+      return false;
+    }
+    if ((result = open_infocom_sound_decoder(decoder)) == false) {
+      TRACE_LOG("Invalid sound file for sound %d.\n", number);
+      release_sound_resource(&decoder->resource);
+    }
+    return result;
+  }
+
+  if (load_sound_resource(entry, &decoder->resource) == false)
+    return false;
+
+  if (entry->chunk_type == BLORB_INDEX_ID('F', 'O', 'R', 'M'))
+    result = open_aiff_decoder(decoder);
+#ifdef ENABLE_OGG_VORBIS
+  else if (entry->chunk_type == BLORB_INDEX_ID('O', 'G', 'G', 'V'))
+    result = open_vorbis_decoder(decoder);
+#endif // ENABLE_OGG_VORBIS
+#ifdef ENABLE_MODPLUG
+  else if (entry->chunk_type == BLORB_INDEX_ID('M', 'O', 'D', ' '))
+    result = open_mod_decoder(decoder);
+#endif // ENABLE_MODPLUG
+
+  if (result == false) {
+    TRACE_LOG("Unsupported sound resource %d.\n", number);
+    release_sound_resource(&decoder->resource);
+  }
+
+  return result;
+}
+
+
+// --- Cache
+
+
+static void unlink_cached_sound(struct cached_sound *cached) {
+  if (cached->prev != NULL)
+    cached->prev->next = cached->next;
+  else
+    first_cached_sound = cached->next;
+
+  if (cached->next != NULL)
+    cached->next->prev = cached->prev;
+  else
+    last_cached_sound = cached->prev;
+}
+
+
+static void link_cached_sound(struct cached_sound *cached) {
+  cached->prev = NULL;
+  cached->next = first_cached_sound;
+  if (first_cached_sound != NULL)
+    first_cached_sound->prev = cached;
+  else
+    last_cached_sound = cached;
+  first_cached_sound = cached;
+}
+
+
+static void free_cached_sound(struct cached_sound *cached) {
+  unlink_cached_sound(cached);
+  cached_sounds_size -= cached->nof_frames * 4;
+  free(cached->frames);
+  free(cached);
+}
+
+
+static bool is_cached_sound_playing(struct cached_sound *cached) {
+  int i;
+
+  for (i=0; i<NUMBER_OF_SOUND_VOICES; i++)
+    if ( (voices[i].is_active == true) && (voices[i].decoder.cached == cached) )
+      return true;
+
+  return false;
+}
+
+
+static struct cached_sound *get_cached_sound(int number) {
+  struct cached_sound *cached;
+
+  for (cached = first_cached_sound; cached != NULL; cached = cached->next) {
+    if (cached->number == number) {
+      unlink_cached_sound(cached);
+      link_cached_sound(cached);
+      return cached;
+    }
+  }
+
+  return NULL;
+}
+
+
+// Evicts the least recently used entries until "size" bytes fit, except
+// for the ones currently playing.
+static void make_room_in_cache(size_t size) {
+  struct cached_sound *cached = last_cached_sound, *prev;
+
+  while ( (cached != NULL) && (cached_sounds_size + size > sound_cache_size) ) {
+    prev = cached->prev;
+    if (is_cached_sound_playing(cached) == false) {
+      TRACE_LOG("Evicting sound %d from cache.\n", cached->number);
+      free_cached_sound(cached);
+    }
+    cached = prev;
+  }
+}
+
+
+static struct cached_sound *add_cached_sound(int number, int rate,
+    int16_t *frames, long nof_frames) {
+  struct cached_sound *cached = fizmo_malloc(sizeof(struct cached_sound));
+
+  make_room_in_cache(nof_frames * 4);
+
+  cached->number = number;
+  cached->rate = rate;
+  cached->frames = frames;
+  cached->nof_frames = nof_frames;
+  cached_sounds_size += nof_frames * 4;
+  link_cached_sound(cached);
+
+  return cached;
+}
+
+
+// The Z-machine's built-in sounds 1 and 2 are a high and a low pitched
+// beep, which are used when the story doesn't supply sounds of its own.
+static struct cached_sound *create_bleep(int number) {
+  long nof_frames = device_frequency * BLEEP_DURATION / 1000, i;
+  int half_period = device_frequency / (number == 1 ? 1600 : 500);
+  int16_t *frames = fizmo_malloc(nof_frames * 4);
+
+  for (i=0; i<nof_frames; i++) {
+    frames[i * 2] = (i / half_period) % 2 == 0
+      ? BLEEP_AMPLITUDE : -BLEEP_AMPLITUDE;
+    frames[i * 2 + 1] = frames[i * 2];
+  }
+
+  return add_cached_sound(number, device_frequency, frames, nof_frames);
+}
+
+
+// Decodes the sound into the cache in case it's short enough. Returns
+// the cache entry, or NULL in case the sound has to be streamed, in
+// which case the opened decoder is returned in "decoder".
+static struct cached_sound *load_sound(int number,
+    struct sound_decoder *decoder, bool *decoder_is_open) {
+  struct cached_sound *cached;
+  int16_t *frames;
+  long nof_frames, nof_decoded;
+
+  *decoder_is_open = false;
+
+  if ((cached = get_cached_sound(number)) != NULL)
+    return cached;
+
+  if (open_sound_decoder(number, decoder) == false)
+    return (number == 1) || (number == 2) ? create_bleep(number) : NULL;
+
+  if ( (decoder->total_frames < 0)
+      || ((size_t)decoder->total_frames * 4
+        > sound_cache_size / SOUND_CACHE_ENTRY_DIVISOR) ) {
+    *decoder_is_open = true;
+    return NULL;
+  }
+
+  TRACE_LOG("Caching sound %d, %ld frames.\n", number, decoder->total_frames);
+
+  frames = fizmo_malloc(decoder->total_frames * 4 + 4);
+  nof_frames = 0;
+  while ( (nof_frames < decoder->total_frames)
+      && ((nof_decoded = decoder->decode(decoder, frames + nof_frames * 2,
+            decoder->total_frames - nof_frames)) > 0) )
+    nof_frames += nof_decoded;
+
+  cached = add_cached_sound(number, decoder->rate, frames, nof_frames);
+  decoder->close(decoder);
+
+  return cached;
+}
+
+
+static void free_sound_cache() {
+  while (first_cached_sound != NULL)
+    free_cached_sound(first_cached_sound);
+}
+
+
+// --- Streaming
+
+
+static void stop_voice(struct sound_voice *voice) {
+  // Whatever's left in the ring belongs to the stopped sound.
+  SDL_AtomicSet(&voice->ring->flush_count,
+      SDL_AtomicGet(&voice->ring->write_count));
+
+  if (voice->is_active == false)
+    return;
+
+  voice->decoder.close(&voice->decoder);
+  free_sound_resampler(&voice->resampler);
+  voice->is_active = false;
+}
+
+
+// Decodes the next source frames into the resampler, restarting the
+// sound while repeats are left. Returns false once the sound has ended.
+static bool feed_resampler(struct sound_voice *voice) {
+  struct sound_decoder *decoder = &voice->decoder;
+  long max_frames, nof_decoded;
+  int16_t *input;
+
+  if (voice->input_finished == true)
+    return false;
+
+  input = get_resampler_input(&voice->resampler, &max_frames);
+  if (max_frames > SOUND_DECODE_FRAMES)
+    max_frames = SOUND_DECODE_FRAMES;
+
+  nof_decoded = decoder->decode(decoder, input, max_frames);
+
+  if ( (nof_decoded <= 0) && (voice->repeats_left != 0)
+      && (decoder->rewind(decoder) == true) ) {
+    if (voice->repeats_left > 0)
+      voice->repeats_left--;
+    nof_decoded = decoder->decode(decoder, input, max_frames);
+  }
+
+  if (nof_decoded <= 0) {
+    finish_resampler_input(&voice->resampler);
+    voice->input_finished = true;
+  }
+  else {
+    add_resampler_input(&voice->resampler, nof_decoded);
+  }
+
+  return true;
+}
+
+
+static long render_voice(struct sound_voice *voice, int16_t *frames,
+    long nof_frames) {
+  long produced = 0;
+
+  while (produced < nof_frames) {
+    produced += resample_frames(
+        &voice->resampler, frames + produced * 2, nof_frames - produced);
+    if ( (produced < nof_frames) && (feed_resampler(voice) == false) )
+      break;
+  }
+
+  return produced;
+}
+
+
+// Renders frames until the voice's ring is full or its sound has ended.
+static void fill_voice_ring(struct sound_voice *voice) {
+  struct voice_ring *ring = voice->ring;
+  uint32_t write = (uint32_t)SDL_AtomicGet(&ring->write_count);
+  uint32_t read = (uint32_t)SDL_AtomicGet(&ring->read_count);
+  long space = SOUND_RING_FRAMES - (int32_t)(write - read), chunk, produced;
+
+  while ( (voice->is_active == true) && (space > 0) ) {
+    // Don't wrap around the ring's end within a chunk.
+    chunk = SOUND_RING_FRAMES - (write & SOUND_RING_MASK);
+    if (chunk > space)
+      chunk = space;
+    if (chunk > SOUND_DECODE_FRAMES)
+      chunk = SOUND_DECODE_FRAMES;
+
+    produced = render_voice(
+        voice, ring->frames + (write & SOUND_RING_MASK) * 2, chunk);
+    write += produced;
+    space -= produced;
+    SDL_AtomicSet(&ring->write_count, (int)write);
+
+    if (produced < chunk) {
+      TRACE_LOG("Sound %d has ended.\n", voice->number);
+      voice->decoder.close(&voice->decoder);
+      free_sound_resampler(&voice->resampler);
+      voice->is_active = false;
+    }
+  }
+}
+
+
+// Returns true in case any sound is still playing after the rings have
+// been filled.
+static bool fill_voice_rings() {
+  bool is_playing = false;
+  int i;
+
+  for (i=0; i<NUMBER_OF_SOUND_VOICES; i++) {
+    fill_voice_ring(&voices[i]);
+    if (voices[i].is_active == true)
+      is_playing = true;
+  }
+
+  return is_playing;
+}
+
+
+static int get_gain(int volume) {
+  // Volumes range from 1 to 8, anything else means the loudest one.
+  return (volume >= 1) && (volume <= 8) ? volume * 32 : 256;
+}
+
+
+static int get_repeats_left(int repeats) {
+  return repeats == 255 ? -1 : repeats > 1 ? repeats - 1 : 0;
+}
+
+
+static struct sound_voice *get_playing_voice(int number) {
+  int i;
+
+  for (i=0; i<NUMBER_OF_SOUND_VOICES; i++)
+    if ( (voices[i].is_active == true) && (voices[i].number == number) )
+      return &voices[i];
+
+  return NULL;
+}
+
+
+static void play_sound_request(struct sound_request *request) {
+  struct sound_decoder decoder;
+  struct cached_sound *cached;
+  struct sound_voice *voice;
+  bool decoder_is_open;
+
+  // Playing a sound which is already playing only changes its volume
+  // and number of repeats.
+  if ((voice = get_playing_voice(request->number)) != NULL) {
+    SDL_AtomicSet(&voice->ring->gain, get_gain(request->volume));
+    voice->repeats_left = get_repeats_left(request->repeats);
+    return;
+  }
+
+  if ((cached = load_sound(request->number, &decoder, &decoder_is_open))
+      != NULL)
+    open_cached_sound_decoder(&decoder, cached);
+  else if (decoder_is_open == false)
+    return;
+
+  voice = &voices[
+    (request->repeats == 255) || (decoder.is_music == true)
+      ? SOUND_VOICE_BACKGROUND
+      : SOUND_VOICE_EFFECT];
+
+  TRACE_LOG("Playing sound %d on voice %d, volume %d, repeats %d.\n",
+      request->number, (int)(voice - voices), request->volume,
+      request->repeats);
+
+  stop_voice(voice);
+  SDL_AtomicSet(&voice->ring->gain, get_gain(request->volume));
+  voice->decoder = decoder;
+  init_sound_resampler(&voice->resampler, decoder.rate, device_frequency);
+  voice->number = request->number;
+  voice->repeats_left = get_repeats_left(request->repeats);
+  voice->input_finished = false;
+  voice->is_active = true;
+}
+
+
+static void process_request(struct sound_request *request) {
+  struct sound_decoder decoder;
+  struct cached_sound *cached;
+  bool decoder_is_open;
+  int i;
+
+  if (request->type == SOUND_REQUEST_PREPARE) {
+    load_sound(request->number, &decoder, &decoder_is_open);
+    if (decoder_is_open == true)
+      decoder.close(&decoder);
+  }
+  else if (request->type == SOUND_REQUEST_PLAY) {
+    play_sound_request(request);
+  }
+  else if (request->type == SOUND_REQUEST_STOP) {
+    for (i=0; i<NUMBER_OF_SOUND_VOICES; i++) {
+      if ( (voices[i].is_active == true)
+          && ( (request->number == 0)
+            || (voices[i].number == request->number) ) )
+        stop_voice(&voices[i]);
+    }
+  }
+  else if (request->type == SOUND_REQUEST_UNLOAD) {
+    if ( ((cached = get_cached_sound(request->number)) != NULL)
+        && (is_cached_sound_playing(cached) == false) )
+      free_cached_sound(cached);
+  }
+}
+
+
+static int sound_worker_thread_function(void *UNUSED(data)) {
+  struct sound_request *request;
+  bool is_playing = false;
+  int i;
+
+  SDL_LockMutex(sound_request_mutex);
+
+  for (;;) {
+    // Rings are full after being filled, so while sounds are playing
+    // the worker only has to wake up now and then to top them up.
+    if ( (first_request == NULL) && (sound_worker_should_stop == false) ) {
+      if (is_playing == false)
+        SDL_CondWait(sound_request_cond, sound_request_mutex);
+      else
+        SDL_CondWaitTimeout(sound_request_cond, sound_request_mutex,
+            SOUND_WORKER_POLL_INTERVAL);
+    }
+
+    if (sound_worker_should_stop == true)
+      break;
+
+    if ((request = first_request) != NULL) {
+      if ((first_request = request->next) == NULL)
+        last_request = NULL;
+    }
+
+    SDL_UnlockMutex(sound_request_mutex);
+
+    if (request != NULL) {
+      process_request(request);
+      free(request);
+    }
+    is_playing = fill_voice_rings();
+
+    SDL_LockMutex(sound_request_mutex);
+  }
+
+  SDL_UnlockMutex(sound_request_mutex);
+
+  for (i=0; i<NUMBER_OF_SOUND_VOICES; i++)
+    stop_voice(&voices[i]);
+
+  return 0;
+}
+
+
+// --- Interface functions, invoked by the interpreter thread
+
+
+static void queue_sound_request(enum sound_request_type type, int number,
+    int volume, int repeats) {
+  struct sound_request *request;
+
+  if (sound_worker_thread == NULL)
+    return;
+
+  request = fizmo_malloc(sizeof(struct sound_request));
+  request->type = type;
+  request->number = number;
+  request->volume = volume;
+  request->repeats = repeats;
+  request->next = NULL;
+
+  SDL_LockMutex(sound_request_mutex);
+  if (last_request != NULL)
+    last_request->next = request;
+  else
+    first_request = request;
+  last_request = request;
+  SDL_CondSignal(sound_request_cond);
+  SDL_UnlockMutex(sound_request_mutex);
+}
+
+
+static void reset_voice_rings(struct voice_ring *rings, int nof_rings) {
+  int i;
+
+  for (i=0; i<nof_rings; i++) {
+    SDL_AtomicSet(&rings[i].write_count, 0);
+    SDL_AtomicSet(&rings[i].read_count, 0);
+    SDL_AtomicSet(&rings[i].flush_count, 0);
+    SDL_AtomicSet(&rings[i].gain, 256);
+    rings[i].mixed_gain = UNMIXED_GAIN;
+  }
+}
+
+
+static void init_sound() {
+  SDL_AudioSpec desired, obtained;
+  char *value;
+  int i;
+
+  if ( (sound_disabled == true) || (sound_worker_thread != NULL) )
+    return;
+
+  if ( (SDL_WasInit(SDL_INIT_AUDIO) == 0)
+      && (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) ) {
+    TRACE_LOG("Could not initialize SDL audio: %s\n", SDL_GetError());
+    return;
+  }
+
+  output_8bit
+    = ( ((value = get_configuration_value("force-8bit-sound")) != NULL)
+        && (*value != 0) )
+    ? true
+    : false;
+
+  SDL_zero(desired);
+  desired.freq = SOUND_DEVICE_FREQUENCY;
+  desired.format = output_8bit == true ? AUDIO_S8 : AUDIO_S16SYS;
+  desired.channels = 2;
+  desired.samples = sound_buffer_samples;
+  desired.callback = &audio_callback;
+
+  if ((sound_device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained,
+          SDL_AUDIO_ALLOW_FREQUENCY_CHANGE)) == 0) {
+    TRACE_LOG("Could not open audio device: %s\n", SDL_GetError());
+    return;
+  }
+
+  TRACE_LOG("Opened audio device using \"%s\", %d Hz, %d samples.\n",
+      SDL_GetCurrentAudioDriver(), obtained.freq, obtained.samples);
+
+  device_frequency = obtained.freq;
+  sound_mix_frames = obtained.samples;
+  sound_mix = fizmo_malloc(sizeof(float) * 2 * sound_mix_frames);
+  reset_voice_rings(voice_rings, NUMBER_OF_SOUND_VOICES);
+  for (i=0; i<NUMBER_OF_SOUND_VOICES; i++) {
+    voices[i].is_active = false;
+    voices[i].ring = &voice_rings[i];
+  }
+
+  sound_request_mutex = SDL_CreateMutex();
+  sound_request_cond = SDL_CreateCond();
+  sound_worker_should_stop = false;
+  sound_worker_thread = SDL_CreateThread(
+      sound_worker_thread_function, "SoundWorker", NULL);
+
+  SDL_PauseAudioDevice(sound_device, 0);
+}
+
+
+static void close_sound() {
+  struct sound_request *request;
+
+  if (sound_worker_thread == NULL)
+    return;
+
+  SDL_LockMutex(sound_request_mutex);
+  sound_worker_should_stop = true;
+  SDL_CondSignal(sound_request_cond);
+  SDL_UnlockMutex(sound_request_mutex);
+  SDL_WaitThread(sound_worker_thread, NULL);
+  sound_worker_thread = NULL;
+
+  SDL_CloseAudioDevice(sound_device);
+  sound_device = 0;
+  free(sound_mix);
+  sound_mix = NULL;
+
+  while ((request = first_request) != NULL) {
+    first_request = request->next;
+    free(request);
+  }
+  last_request = NULL;
+
+  free_sound_cache();
+  SDL_DestroyCond(sound_request_cond);
+  SDL_DestroyMutex(sound_request_mutex);
+}
+
+
+static void prepare_sound(int number, int UNUSED(volume),
+    int UNUSED(repeats)) {
+  queue_sound_request(SOUND_REQUEST_PREPARE, number, 0, 0);
+}
+
+
+// The sound interface offers no way to hand a routine back to the
+// interpreter, so sounds are played without invoking it.
+static void play_sound(int number, int volume, int repeats,
+    uint16_t UNUSED(routine)) {
+  queue_sound_request(SOUND_REQUEST_PLAY, number, volume, repeats);
+}
+
+
+static void stop_sound(int number) {
+  queue_sound_request(SOUND_REQUEST_STOP, number, 0, 0);
+}
+
+
+static void finish_sound(int number) {
+  queue_sound_request(SOUND_REQUEST_UNLOAD, number, 0, 0);
+}
+
+
+static void keyboard_input_has_occurred() {
+}
+
+
+static char *get_interface_name() {
+  return SDL2_SOUND_INTERFACE_NAME;
+}
+
+
+static char *get_interface_version() {
+  return SDL2_SOUND_INTERFACE_VERSION;
+}
+
+
+static int parse_config_parameter(char *key, char *value) {
+  long long_value;
+  char *endptr;
+
+  if (strcasecmp(key, "sound-buffer-samples") == 0) {
+    if ( (value == NULL) || (strlen(value) == 0) ) {
+      free(value);
+      return -1;
+    }
+    long_value = strtol(value, &endptr, 10);
+    // SDL requires a power of two.
+    if ( (*endptr != 0) || (long_value < 64) || (long_value > 8192)
+        || ((long_value & (long_value - 1)) != 0) ) {
+      free(value);
+      return -1;
+    }
+    free(value);
+    sound_buffer_samples = long_value;
+    return 0;
+  }
+  else if (strcasecmp(key, "sound-cache-size") == 0) {
+    if ( (value == NULL) || (strlen(value) == 0) ) {
+      free(value);
+      return -1;
+    }
+    long_value = strtol(value, &endptr, 10);
+    if ( (*endptr != 0) || (long_value < 0) ) {
+      free(value);
+      return -1;
+    }
+    free(value);
+    sound_cache_size = (size_t)long_value * 1024;
+    return 0;
+  }
+  else {
+    return -2;
+  }
+}
+
+
+static char *get_config_value(char *key) {
+  if (strcasecmp(key, "sound-buffer-samples") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%d",
+        sound_buffer_samples);
+    return config_value_buf;
+  }
+  else if (strcasecmp(key, "sound-cache-size") == 0) {
+    snprintf(config_value_buf, CONFIG_VALUE_BUF_SIZE, "%lu",
+        (unsigned long)(sound_cache_size / 1024));
+    return config_value_buf;
+  }
+  else {
+    return NULL;
+  }
+}
+
+
+static char **get_config_option_names() {
+  return config_option_names;
+}
+
+
+// Runs the callback's mixing on synthetic voices whose volume changes
+// with every callback, so that all gains are ramped, and compares the
+// time taken to the duration of the buffer being filled. The resampler,
+// which runs on the worker thread, is measured by how many times faster
+// than real time it converts sounds at common rates.
+void run_sound_benchmark() {
+  static const int voice_counts[] = { 1, 2, 4, 8 };
+  static const int source_rates[] = { 11025, 22050, 32000, 48000 };
+  struct voice_ring *rings = fizmo_malloc(
+      sizeof(struct voice_ring) * SOUND_BENCHMARK_MAX_VOICES);
+  struct sound_resampler *resampler
+    = fizmo_malloc(sizeof(struct sound_resampler));
+  Uint64 frequency = SDL_GetPerformanceFrequency(), start, elapsed, total;
+  Uint64 max_elapsed;
+  double budget
+    = 1e6 * sound_buffer_samples / SOUND_DEVICE_FREQUENCY, average;
+  long nof_frames, produced, max_frames;
+  int16_t *output, *input;
+  uint32_t seed = 1;
+  int i, j, k;
+
+  sound_mix_frames = sound_buffer_samples;
+  sound_mix = fizmo_malloc(sizeof(float) * 2 * sound_mix_frames);
+  output = fizmo_malloc(sizeof(int16_t) * 2
+      * (sound_buffer_samples > SOUND_DECODE_FRAMES
+        ? sound_buffer_samples : SOUND_DECODE_FRAMES));
+  output_8bit = false;
+
+  reset_voice_rings(rings, SOUND_BENCHMARK_MAX_VOICES);
+  for (i=0; i<SOUND_BENCHMARK_MAX_VOICES; i++) {
+    for (j=0; j<2*SOUND_RING_FRAMES; j++) {
+      seed = seed * 1664525 + 1013904223;
+      rings[i].frames[j] = (int16_t)(seed >> 16) / 4;
+    }
+  }
+
+  printf("\nMixing %d frames per callback, %.1f us of audio at %d Hz.\n\n",
+      sound_buffer_samples, budget, SOUND_DEVICE_FREQUENCY);
+  printf("%6s %12s %12s %10s\n", "voices", "average us", "maximum us",
+      "of budget");
+
+  for (i=0; i<(int)(sizeof(voice_counts)/sizeof(int)); i++) {
+    total = 0;
+    max_elapsed = 0;
+
+    for (j=0; j<SOUND_BENCHMARK_CALLBACKS; j++) {
+      for (k=0; k<voice_counts[i]; k++) {
+        SDL_AtomicSet(&rings[k].gain, j % 2 == 0 ? 256 : 128);
+        SDL_AtomicSet(&rings[k].read_count, 0);
+        SDL_AtomicSet(&rings[k].write_count, SOUND_RING_FRAMES);
+      }
+
+      start = SDL_GetPerformanceCounter();
+      mix_voice_rings(
+          rings, voice_counts[i], (Uint8*)output, sound_buffer_samples);
+      elapsed = SDL_GetPerformanceCounter() - start;
+
+      total += elapsed;
+      if (elapsed > max_elapsed)
+        max_elapsed = elapsed;
+    }
+
+    average = 1e6 * total / frequency / SOUND_BENCHMARK_CALLBACKS;
+    printf("%6d %12.2f %12.2f %9.2f%%\n", voice_counts[i], average,
+        1e6 * max_elapsed / frequency, 100 * average / budget);
+  }
+
+  printf("\n%6s %12s %12s\n", "rate", "ms per 10 s", "x real time");
+
+  for (i=0; i<(int)(sizeof(source_rates)/sizeof(int)); i++) {
+    init_sound_resampler(
+        resampler, source_rates[i], SOUND_DEVICE_FREQUENCY);
+    nof_frames = 0;
+
+    start = SDL_GetPerformanceCounter();
+    while (nof_frames < SOUND_BENCHMARK_SECONDS * SOUND_DEVICE_FREQUENCY) {
+      produced = resample_frames(resampler, output, SOUND_DECODE_FRAMES);
+      if (produced == 0) {
+        input = get_resampler_input(resampler, &max_frames);
+        memcpy(input, rings[0].frames, max_frames * 4);
+        add_resampler_input(resampler, max_frames);
+      }
+      nof_frames += produced;
+    }
+    elapsed = SDL_GetPerformanceCounter() - start;
+    free_sound_resampler(resampler);
+
+    printf("%6d %12.2f %12.1f\n", source_rates[i],
+        1e3 * elapsed / frequency,
+        (double)SOUND_BENCHMARK_SECONDS * frequency / elapsed);
+  }
+
+  printf("\n");
+
+  free(output);
+  free(sound_mix);
+  sound_mix = NULL;
+  free(resampler);
+  free(rings);
+}
+
+
+void set_sdl2_sound_story_file(char *story_filename) {
+  char *name, *suffix;
+  size_t name_len;
+
+  free(infocom_sound_prefix);
+
+  if ((name = strrchr(story_filename, '/')) != NULL)
+    name++;
+  else
+    name = story_filename;
+
+  if ((suffix = strrchr(name, '.')) != NULL)
+    name_len = suffix - name;
+  else
+    name_len = strlen(name);
+
+  if (name_len > INFOCOM_SOUND_NAME_LENGTH)
+    name_len = INFOCOM_SOUND_NAME_LENGTH;
+
+  infocom_sound_name_offset = name - story_filename;
+  name_len += infocom_sound_name_offset;
+  infocom_sound_prefix = fizmo_malloc(name_len + 1);
+  memcpy(infocom_sound_prefix, story_filename, name_len);
+  infocom_sound_prefix[name_len] = 0;
+}
+
+
+void disable_sdl2_sound() {
+  // The worker thread and its locks didn't survive the fork, so they
+  // must not be touched.
+  sound_disabled = true;
+  sound_worker_thread = NULL;
+  sound_device = 0;
+}
+
+
+struct z_sound_interface sdl2_sound_interface = {
+  &init_sound,
+  &close_sound,
+  &prepare_sound,
+  &play_sound,
+  &stop_sound,
+  &finish_sound,
+  &keyboard_input_has_occurred,
+  &get_interface_name,
+  &get_interface_version,
+  &parse_config_parameter,
+  &get_config_value,
+  &get_config_option_names
+};
+
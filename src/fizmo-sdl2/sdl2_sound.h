@@ -0,0 +1,83 @@
+/* sdl2_sound.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A sound interface playing blorb sound resources through SDL's audio
+ * subsystem. AIFF resources are always supported, Ogg Vorbis and MOD
+ * resources in case libvorbisfile and libmodplug were available at build
+ * time. Sounds missing from the blorb are read from Infocom's separate
+ * sound files instead, in case these exist next to the story file.
+ *
+ * All decoding happens on a worker thread of its own, which streams the
+ * converted samples into a lock-free ring the SDL audio callback reads
+ * from. The interpreter thread only queues requests for the worker, so
+ * it never waits for decoding or the audio device. Short sounds are kept
+ * decoded in a cache, so that repeated effects start without having to
+ * be decoded again.
+ *
+ * Effects and background sounds -- the ones repeated until stopped and
+ * music -- play on voices of their own, so that they may overlap. The
+ * callback mixes the voices and ramps volume changes, while resampling
+ * to the device's rate is done on the worker.
+ *
+ * Since nothing depends on an actual sound device, SDL's "dummy" or
+ * "disk" audio drivers, selected using the SDL_AUDIODRIVER environment
+ * variable, may be used on machines without one.
+ *
+ */
+
+
+#ifndef sdl2_sound_h_INCLUDED
+#define sdl2_sound_h_INCLUDED
+
+#include <sound_interface/sound_interface.h>
+
+#define DEFAULT_SOUND_BUFFER_SAMPLES 512
+#define DEFAULT_SOUND_CACHE_SIZE 4096
+
+extern struct z_sound_interface sdl2_sound_interface;
+
+// Measures the time the audio callback takes for mixing and the
+// resampler's throughput, and prints the results to stdout.
+void run_sound_benchmark();
+
+// Sets the story file, next to which Infocom sound files like
+// "LURKIN07.SND" are looked for in case a sound isn't found in the blorb.
+void set_sdl2_sound_story_file(char *story_filename);
+
+// Invoked in forked children, which don't have the worker thread and
+// audio device of their parent. All further requests are ignored.
+void disable_sdl2_sound();
+
+#endif // sdl2_sound_h_INCLUDED
+
@@ -0,0 +1,274 @@
+/* smooth_scroll.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include <tools/tracelog.h>
+#include <tools/types.h>
+
+#include "smooth_scroll.h"
+#include "damage_tracker.h"
+#include "framebuffer.h"
+
+// Every frame shows the remaining animation distance divided by this.
+#define SCROLL_ANIMATION_DIVISOR 3
+
+static bool smooth_scrolling_enabled = false;
+static SDL_Renderer *scroll_renderer = NULL;
+static SDL_ScaleMode scroll_scale_mode = SDL_ScaleModeLinear;
+
+// Written by the interpreter thread, read by the main thread while the
+// interpreter waits for a screen update.
+static SDL_Rect registered_region = { 0, 0, 0, 0 };
+static bool region_was_reset = false;
+static int registered_distance = 0;
+
+// Owned by the main thread.
+static SDL_Texture *ring_texture = NULL;
+static SDL_Rect ring_region = { 0, 0, 0, 0 };
+static int ring_height = 0;
+// Texture row holding the region's first row.
+static int ring_start = 0;
+// Number of rows the displayed region still lags behind.
+static int animation_lag = 0;
+
+
+void set_smooth_scrolling_enabled(bool enabled) {
+  smooth_scrolling_enabled = enabled;
+}
+
+
+bool is_smooth_scrolling_enabled() {
+  return smooth_scrolling_enabled;
+}
+
+
+void init_smooth_scroll(SDL_Renderer *renderer, SDL_ScaleMode scale_mode) {
+  if (smooth_scrolling_enabled == true) {
+    scroll_renderer = renderer;
+    scroll_scale_mode = scale_mode;
+  }
+}
+
+
+static void destroy_ring() {
+  if (ring_texture != NULL) {
+    SDL_DestroyTexture(ring_texture);
+    ring_texture = NULL;
+  }
+  ring_region.h = 0;
+  animation_lag = 0;
+}
+
+
+void free_smooth_scroll() {
+  destroy_ring();
+}
+
+
+bool register_scroll(int dsty, int dstx, int srcy, int srcx, int height,
+    int width) {
+  SDL_Rect region;
+  int distance;
+
+  if ( (scroll_renderer == NULL)
+      || (srcx != dstx)
+      || (srcy <= dsty)
+      || (width <= 0)
+      || (height <= 0) )
+    return false;
+
+  distance = srcy - dsty;
+  region.x = dstx;
+  region.y = dsty;
+  region.w = width;
+  region.h = height + distance;
+
+  if ( (region.x != registered_region.x)
+      || (region.y != registered_region.y)
+      || (region.w != registered_region.w)
+      || (region.h != registered_region.h) ) {
+    // The ring is recreated by the main thread and has to be filled
+    // completely.
+    TRACE_LOG("New scroll region %d,%d / %dx%d.\n",
+        region.x, region.y, region.w, region.h);
+    registered_region = region;
+    region_was_reset = true;
+    registered_distance = 0;
+    mark_damaged_area(region.x, region.y, region.w, region.h);
+    return true;
+  }
+
+  registered_distance += distance;
+
+  // What was damaged before moves along with the contents, while the
+  // rows at the bottom are now new to the ring.
+  scroll_damage(region.x, region.y, region.w, region.h, distance);
+  mark_damaged_area(region.x, region.y + height, region.w, distance);
+
+  return true;
+}
+
+
+void reset_scroll_region() {
+  registered_region.h = 0;
+  region_was_reset = true;
+  registered_distance = 0;
+}
+
+
+bool apply_registered_scrolls(SDL_Rect *region) {
+  if (scroll_renderer == NULL)
+    return false;
+
+  if (region_was_reset == true) {
+    region_was_reset = false;
+    destroy_ring();
+
+    if (registered_region.h > 0) {
+      // Twice the region's height leaves room to animate scrolling by up
+      // to a whole window.
+      ring_region = registered_region;
+      ring_height = ring_region.h * 2;
+      ring_start = 0;
+      if ((ring_texture = SDL_CreateTexture(scroll_renderer,
+              SDL_PIXELFORMAT_ARGB8888,
+              SDL_TEXTUREACCESS_STREAMING,
+              ring_region.w,
+              ring_height)) == NULL) {
+        // Scrolls registered from here on would only damage the rows new
+        // to the ring, so fall back to plain redrawing for good.
+        TRACE_LOG("Could not create scroll ring: %s\n", SDL_GetError());
+        ring_region.h = 0;
+        scroll_renderer = NULL;
+        mark_everything_damaged();
+        return false;
+      }
+      else {
+        SDL_SetTextureScaleMode(ring_texture, scroll_scale_mode);
+      }
+    }
+  }
+
+  if ( (ring_texture == NULL) || (registered_distance == 0) )
+    return false;
+
+  ring_start = (ring_start + registered_distance) % ring_height;
+  // When the contents moved by more than the region's height, the rows
+  // scrolled through in between never reached the ring, and there is
+  // nothing to animate from.
+  if (registered_distance > ring_region.h)
+    animation_lag = 0;
+  else {
+    animation_lag += registered_distance;
+    if (animation_lag > ring_height - ring_region.h)
+      animation_lag = ring_height - ring_region.h;
+  }
+  registered_distance = 0;
+
+  *region = ring_region;
+  return true;
+}
+
+
+void upload_scroll_region(SDL_Surface *framebuffer, const SDL_Rect *span) {
+  SDL_Rect part;
+  int top, bottom, ring_row;
+
+  if (ring_texture == NULL)
+    return;
+
+  top = span->y > ring_region.y ? span->y : ring_region.y;
+  bottom = span->y + span->h < ring_region.y + ring_region.h
+    ? span->y + span->h
+    : ring_region.y + ring_region.h;
+
+  part.x = ring_region.x;
+  part.w = ring_region.w;
+
+  // The ring may wrap around inside the span.
+  while (top < bottom) {
+    ring_row = (ring_start + top - ring_region.y) % ring_height;
+    part.y = top;
+    part.h = bottom - top;
+    if (ring_row + part.h > ring_height)
+      part.h = ring_height - ring_row;
+    upload_framebuffer_rect(ring_texture, ring_row, framebuffer, &part);
+    top += part.h;
+  }
+}
+
+
+void render_scroll_region(float x_scale, float y_scale) {
+  SDL_Rect src;
+  SDL_FRect dest;
+  int first_ring_row, row, rows;
+
+  if (ring_texture == NULL)
+    return;
+
+  first_ring_row
+    = (ring_start - animation_lag + ring_height) % ring_height;
+
+  src.x = 0;
+  src.w = ring_region.w;
+  dest.x = ring_region.x * x_scale;
+  dest.w = ring_region.w * x_scale;
+
+  for (row=0; row<ring_region.h; row+=rows) {
+    src.y = (first_ring_row + row) % ring_height;
+    rows = ring_region.h - row;
+    if (src.y + rows > ring_height)
+      rows = ring_height - src.y;
+    src.h = rows;
+    dest.y = (ring_region.y + row) * y_scale;
+    dest.h = rows * y_scale;
+    SDL_RenderCopyF(scroll_renderer, ring_texture, &src, &dest);
+  }
+}
+
+
+bool advance_scroll_animation() {
+  if (animation_lag == 0)
+    return false;
+
+  animation_lag
+    -= (animation_lag + SCROLL_ANIMATION_DIVISOR - 1)
+    / SCROLL_ANIMATION_DIVISOR;
+
+  return true;
+}
+
@@ -0,0 +1,88 @@
+/* smooth_scroll.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * When smooth scrolling is enabled, the region libpixelif scrolls -- which
+ * is the story window -- is kept in a separate ring texture. Scrolling is
+ * done by moving the ring's start row, so only the newly exposed rows have
+ * to be uploaded. The ring is taller than the region, which allows the
+ * scroll to be animated by showing some of the rows which have just been
+ * scrolled out over the following frames.
+ *
+ * The framebuffer itself is still scrolled by copy_area, since it always
+ * has to hold the complete screen.
+ *
+ */
+
+
+#ifndef smooth_scroll_h_INCLUDED
+#define smooth_scroll_h_INCLUDED
+
+#include <SDL2/SDL.h>
+
+#include <tools/types.h>
+
+void set_smooth_scrolling_enabled(bool enabled);
+bool is_smooth_scrolling_enabled();
+
+// Invoked by the interpreter thread after the framebuffer has been
+// scrolled. Returns false in case the copy is no scroll the ring can
+// follow, in which case the destination has to be marked as damaged.
+bool register_scroll(int dsty, int dstx, int srcy, int srcx, int height,
+    int width);
+void reset_scroll_region();
+
+// The functions below are invoked by the main thread.
+void init_smooth_scroll(SDL_Renderer *renderer, SDL_ScaleMode scale_mode);
+void free_smooth_scroll();
+
+// Applies all scrolls registered since the last frame. To be invoked
+// while the interpreter waits for the screen update, before uploading.
+// Returns true and stores the scroll region in "region" in case there
+// were any scrolls, since these aren't part of the damage.
+bool apply_registered_scrolls(SDL_Rect *region);
+
+// Uploads the part of the given damaged framebuffer rows which lies
+// inside the scroll region to the ring texture.
+void upload_scroll_region(SDL_Surface *framebuffer, const SDL_Rect *span);
+
+// Draws the scroll region over the framebuffer's texture. "x_scale" and
+// "y_scale" map framebuffer to output coordinates.
+void render_scroll_region(float x_scale, float y_scale);
+
+// Advances the scroll animation by one frame, returns true if there's
+// still a frame to present.
+bool advance_scroll_animation();
+
+#endif // smooth_scroll_h_INCLUDED
+
@@ -0,0 +1,207 @@
+/* sound_mixer.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <math.h>
+#include <string.h>
+
+#include <tools/types.h>
+
+#include "sound_mixer.h"
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#define SOUND_MIXER_X86
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) \
+  && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define SOUND_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+
+static int16_t clamp_sample(float sample) {
+  if (sample >= 32767)
+    return 32767;
+  if (sample <= -32768)
+    return -32768;
+  return (int16_t)lrintf(sample);
+}
+
+
+#ifdef SOUND_MIXER_X86
+
+// Every iteration mixes four frames. The gains of the left and right
+// samples of a frame are the same, so each gain is present twice.
+static int mix_sound_frames_sse2(float *mix, const int16_t *frames,
+    int nof_frames, float gain, float gain_step) {
+  __m128 gains_lo = _mm_setr_ps(
+      gain, gain, gain + gain_step, gain + gain_step);
+  __m128 gains_hi = _mm_setr_ps(
+      gain + 2 * gain_step, gain + 2 * gain_step,
+      gain + 3 * gain_step, gain + 3 * gain_step);
+  const __m128 advance = _mm_set1_ps(4 * gain_step);
+  __m128i samples;
+  __m128 lo, hi;
+  int i;
+
+  for (i=0; i+4<=nof_frames; i+=4) {
+    samples = _mm_loadu_si128((const __m128i*)(frames + i*2));
+    // Sign-extend the words by moving them to the upper half first.
+    lo = _mm_cvtepi32_ps(
+        _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+    hi = _mm_cvtepi32_ps(
+        _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+    _mm_storeu_ps(mix + i*2,
+        _mm_add_ps(_mm_loadu_ps(mix + i*2), _mm_mul_ps(lo, gains_lo)));
+    _mm_storeu_ps(mix + i*2 + 4,
+        _mm_add_ps(_mm_loadu_ps(mix + i*2 + 4), _mm_mul_ps(hi, gains_hi)));
+    gains_lo = _mm_add_ps(gains_lo, advance);
+    gains_hi = _mm_add_ps(gains_hi, advance);
+  }
+
+  return i;
+}
+
+
+// _mm_cvtps_epi32 rounds to nearest like lrintf, and _mm_packs_epi32
+// saturates.
+static int convert_sound_mix_to_s16_sse2(const float *mix, int16_t *output,
+    int nof_frames) {
+  int i;
+
+  for (i=0; i+4<=nof_frames; i+=4) {
+    _mm_storeu_si128((__m128i*)(output + i*2),
+        _mm_packs_epi32(
+          _mm_cvtps_epi32(_mm_loadu_ps(mix + i*2)),
+          _mm_cvtps_epi32(_mm_loadu_ps(mix + i*2 + 4))));
+  }
+
+  return i;
+}
+
+#endif // SOUND_MIXER_X86
+
+
+#ifdef SOUND_MIXER_NEON
+
+static int mix_sound_frames_neon(float *mix, const int16_t *frames,
+    int nof_frames, float gain, float gain_step) {
+  const float initial_gains[8] = {
+    gain, gain, gain + gain_step, gain + gain_step,
+    gain + 2 * gain_step, gain + 2 * gain_step,
+    gain + 3 * gain_step, gain + 3 * gain_step };
+  float32x4_t gains_lo = vld1q_f32(initial_gains);
+  float32x4_t gains_hi = vld1q_f32(initial_gains + 4);
+  const float32x4_t advance = vdupq_n_f32(4 * gain_step);
+  int16x8_t samples;
+  int i;
+
+  for (i=0; i+4<=nof_frames; i+=4) {
+    samples = vld1q_s16(frames + i*2);
+    vst1q_f32(mix + i*2,
+        vmlaq_f32(vld1q_f32(mix + i*2),
+          vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), gains_lo));
+    vst1q_f32(mix + i*2 + 4,
+        vmlaq_f32(vld1q_f32(mix + i*2 + 4),
+          vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), gains_hi));
+    gains_lo = vaddq_f32(gains_lo, advance);
+    gains_hi = vaddq_f32(gains_hi, advance);
+  }
+
+  return i;
+}
+
+
+#ifdef __aarch64__
+static int convert_sound_mix_to_s16_neon(const float *mix, int16_t *output,
+    int nof_frames) {
+  int i;
+
+  for (i=0; i+4<=nof_frames; i+=4) {
+    vst1q_s16(output + i*2,
+        vcombine_s16(
+          vqmovn_s32(vcvtnq_s32_f32(vld1q_f32(mix + i*2))),
+          vqmovn_s32(vcvtnq_s32_f32(vld1q_f32(mix + i*2 + 4)))));
+  }
+
+  return i;
+}
+#endif // __aarch64__
+
+#endif // SOUND_MIXER_NEON
+
+
+void clear_sound_mix(float *mix, int nof_frames) {
+  memset(mix, 0, sizeof(float) * 2 * nof_frames);
+}
+
+
+void mix_sound_frames(float *mix, const int16_t *frames, int nof_frames,
+    float gain, float gain_step) {
+  int i = 0;
+
+#if defined(SOUND_MIXER_X86)
+  i = mix_sound_frames_sse2(mix, frames, nof_frames, gain, gain_step);
+#elif defined(SOUND_MIXER_NEON)
+  i = mix_sound_frames_neon(mix, frames, nof_frames, gain, gain_step);
+#endif
+
+  for (; i<nof_frames; i++) {
+    mix[i*2] += frames[i*2] * (gain + i * gain_step);
+    mix[i*2 + 1] += frames[i*2 + 1] * (gain + i * gain_step);
+  }
+}
+
+
+void convert_sound_mix_to_s16(const float *mix, int16_t *output,
+    int nof_frames) {
+  int i = 0;
+
+#if defined(SOUND_MIXER_X86)
+  i = convert_sound_mix_to_s16_sse2(mix, output, nof_frames);
+#elif defined(SOUND_MIXER_NEON) && defined(__aarch64__)
+  i = convert_sound_mix_to_s16_neon(mix, output, nof_frames);
+#endif
+
+  for (i*=2; i<nof_frames*2; i++)
+    output[i] = clamp_sample(mix[i]);
+}
+
+
+void convert_sound_mix_to_s8(const float *mix, int8_t *output,
+    int nof_frames) {
+  int i;
+
+  for (i=0; i<nof_frames*2; i++)
+    output[i] = clamp_sample(mix[i]) >> 8;
+}
+
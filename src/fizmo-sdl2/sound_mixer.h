@@ -0,0 +1,63 @@
+/* sound_mixer.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * Mixing kernels for the audio callback. Voices of interleaved 16-bit
+ * stereo frames are summed into a float accumulator, each scaled by a
+ * gain ramping linearly across the mixed frames so that volume changes
+ * don't click, and the sum is then converted to the device's format
+ * with saturation. The kernels use SSE2 on x86 and NEON on ARM when
+ * available and fall back to plain C otherwise.
+ *
+ */
+
+
+#ifndef sound_mixer_h_INCLUDED
+#define sound_mixer_h_INCLUDED
+
+#include <tools/types.h>
+
+void clear_sound_mix(float *mix, int nof_frames);
+
+// Adds the frames to the mix, scaled by a gain starting at "gain" and
+// changing by "gain_step" with every frame.
+void mix_sound_frames(float *mix, const int16_t *frames, int nof_frames,
+    float gain, float gain_step);
+
+void convert_sound_mix_to_s16(const float *mix, int16_t *output,
+    int nof_frames);
+void convert_sound_mix_to_s8(const float *mix, int8_t *output,
+    int nof_frames);
+
+#endif // sound_mixer_h_INCLUDED
+
@@ -0,0 +1,208 @@
+/* sound_resampler.c
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <math.h>
+#include <string.h>
+
+#include <tools/types.h>
+
+#include "sound_resampler.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif // M_PI
+
+// Fraction of the lower rate's Nyquist frequency which is passed, the
+// rest is left for the filter's transition band.
+#define RESAMPLER_CUTOFF 0.9
+
+// Frames which have to be kept before and after the position of the
+// target frame being computed.
+#define RESAMPLER_HISTORY (RESAMPLER_TAPS / 2 - 1)
+#define RESAMPLER_LOOKAHEAD (RESAMPLER_TAPS / 2)
+
+
+static float *create_filter(int source_rate, int target_rate) {
+  float *filter = fizmo_malloc(
+      sizeof(float) * RESAMPLER_PHASES * RESAMPLER_TAPS);
+  double cutoff = RESAMPLER_CUTOFF, t, x, n, window, sum;
+  double coefficients[RESAMPLER_TAPS];
+  int phase, tap;
+
+  if (target_rate < source_rate)
+    cutoff = cutoff * target_rate / source_rate;
+
+  for (phase=0; phase<RESAMPLER_PHASES; phase++) {
+    sum = 0;
+    for (tap=0; tap<RESAMPLER_TAPS; tap++) {
+      // Distance from the target frame's position, in source frames.
+      t = tap - RESAMPLER_HISTORY - (double)phase / RESAMPLER_PHASES;
+      x = M_PI * cutoff * t;
+      // Blackman window spanning all taps.
+      n = t / (RESAMPLER_TAPS / 2);
+      window = 0.42 + 0.5 * cos(M_PI * n) + 0.08 * cos(2 * M_PI * n);
+      coefficients[tap] = (x == 0 ? 1 : sin(x) / x) * window;
+      sum += coefficients[tap];
+    }
+    // Each phase is normalized to unity gain, so that the phases don't
+    // modulate the signal's level.
+    for (tap=0; tap<RESAMPLER_TAPS; tap++)
+      filter[phase * RESAMPLER_TAPS + tap] = coefficients[tap] / sum;
+  }
+
+  return filter;
+}
+
+
+void init_sound_resampler(struct sound_resampler *resampler,
+    int source_rate, int target_rate) {
+  if (source_rate == target_rate) {
+    resampler->filter = NULL;
+    resampler->step = 1 << 16;
+    resampler->position = 0;
+    resampler->nof_frames = 0;
+    return;
+  }
+
+  resampler->filter = create_filter(source_rate, target_rate);
+  resampler->step = ((uint64_t)source_rate << 16) / target_rate;
+  // The first source frame is preceded by silence.
+  resampler->position = RESAMPLER_HISTORY << 16;
+  resampler->nof_frames = RESAMPLER_HISTORY;
+  memset(resampler->frames, 0, RESAMPLER_HISTORY * 4);
+}
+
+
+void free_sound_resampler(struct sound_resampler *resampler) {
+  free(resampler->filter);
+  resampler->filter = NULL;
+}
+
+
+int16_t *get_resampler_input(struct sound_resampler *resampler,
+    long *max_frames) {
+  long first_needed = resampler->position >> 16;
+
+  if (resampler->filter != NULL)
+    first_needed -= RESAMPLER_HISTORY;
+
+  // The position may have skipped beyond the buffered frames when
+  // downsampling.
+  if (first_needed > resampler->nof_frames)
+    first_needed = resampler->nof_frames;
+
+  if (first_needed > 0) {
+    memmove(resampler->frames, resampler->frames + first_needed * 2,
+        (resampler->nof_frames - first_needed) * 4);
+    resampler->nof_frames -= first_needed;
+    resampler->position -= (uint32_t)first_needed << 16;
+  }
+
+  *max_frames = RESAMPLER_INPUT_FRAMES + RESAMPLER_TAPS
+    - resampler->nof_frames;
+
+  return resampler->frames + resampler->nof_frames * 2;
+}
+
+
+void add_resampler_input(struct sound_resampler *resampler,
+    long nof_frames) {
+  resampler->nof_frames += nof_frames;
+}
+
+
+void finish_resampler_input(struct sound_resampler *resampler) {
+  int16_t *input;
+  long max_frames;
+
+  if (resampler->filter == NULL)
+    return;
+
+  input = get_resampler_input(resampler, &max_frames);
+  memset(input, 0, RESAMPLER_LOOKAHEAD * 4);
+  resampler->nof_frames += RESAMPLER_LOOKAHEAD;
+}
+
+
+static int16_t clamp_sample(float sample) {
+  if (sample >= 32767)
+    return 32767;
+  if (sample <= -32768)
+    return -32768;
+  return (int16_t)lrintf(sample);
+}
+
+
+long resample_frames(struct sound_resampler *resampler, int16_t *output,
+    long max_frames) {
+  long produced = 0, index;
+  const int16_t *src;
+  const float *coefficients;
+  float left, right;
+  int tap;
+
+  if (resampler->filter == NULL) {
+    index = resampler->position >> 16;
+    if (max_frames > resampler->nof_frames - index)
+      max_frames = resampler->nof_frames - index;
+    if (max_frames <= 0)
+      return 0;
+    memcpy(output, resampler->frames + index * 2, max_frames * 4);
+    resampler->position += (uint32_t)max_frames << 16;
+    return max_frames;
+  }
+
+  while (produced < max_frames) {
+    index = resampler->position >> 16;
+    if (index + RESAMPLER_LOOKAHEAD >= resampler->nof_frames)
+      break;
+
+    coefficients = resampler->filter + RESAMPLER_TAPS
+      * ((resampler->position & 0xffff) >> (16 - RESAMPLER_PHASE_BITS));
+    src = resampler->frames + (index - RESAMPLER_HISTORY) * 2;
+    left = 0;
+    right = 0;
+    for (tap=0; tap<RESAMPLER_TAPS; tap++) {
+      left += src[tap * 2] * coefficients[tap];
+      right += src[tap * 2 + 1] * coefficients[tap];
+    }
+
+    output[produced * 2] = clamp_sample(left);
+    output[produced * 2 + 1] = clamp_sample(right);
+    produced++;
+    resampler->position += resampler->step;
+  }
+
+  return produced;
+}
+
@@ -0,0 +1,86 @@
+/* sound_resampler.h
+ *
+ * This file is part of fizmo.
+ *
+ * Copyright (c) 2026 Christoph Ender.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *
+ *
+ * A polyphase resampler converting interleaved 16-bit stereo frames
+ * between sample rates. Every target frame is computed by a windowed
+ * sinc filter whose phase is picked from a precomputed table according
+ * to the target frame's position between two source frames. When
+ * downsampling, the filter's cutoff is lowered to the target's Nyquist
+ * frequency. Equal rates pass the frames through unchanged.
+ *
+ */
+
+
+#ifndef sound_resampler_h_INCLUDED
+#define sound_resampler_h_INCLUDED
+
+#include <tools/types.h>
+
+#define RESAMPLER_TAPS 16
+#define RESAMPLER_PHASE_BITS 7
+#define RESAMPLER_PHASES (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_INPUT_FRAMES 1024
+
+struct sound_resampler {
+  // Source frames per target frame and the position of the next target
+  // frame within "frames", both in 16.16 fixed point.
+  uint32_t step;
+  uint32_t position;
+  // RESAMPLER_PHASES rows of RESAMPLER_TAPS coefficients, NULL in case
+  // the rates are equal.
+  float *filter;
+  long nof_frames;
+  int16_t frames[2 * (RESAMPLER_INPUT_FRAMES + RESAMPLER_TAPS)];
+};
+
+void init_sound_resampler(struct sound_resampler *resampler,
+    int source_rate, int target_rate);
+void free_sound_resampler(struct sound_resampler *resampler);
+
+// Returns where up to "max_frames" new source frames may be stored, which
+// are then added using add_resampler_input.
+int16_t *get_resampler_input(struct sound_resampler *resampler,
+    long *max_frames);
+void add_resampler_input(struct sound_resampler *resampler, long nof_frames);
+// Appends the silence needed to convert the last source frames. Must be
+// called once after the source has ended.
+void finish_resampler_input(struct sound_resampler *resampler);
+
+// Converts as many of the buffered source frames as possible, up to
+// "max_frames". Returns the number of target frames written.
+long resample_frames(struct sound_resampler *resampler, int16_t *output,
+    long max_frames);
+
+#endif // sound_resampler_h_INCLUDED
+
@@ -97,6 +97,13 @@
 #define i18n_sdl2_PROCESS_SDL2_EVENTS 59
 #define i18n_sdl2_WINDOW_WIDTH_TOO_NARROW_MINIMUM_IS_P0D 60
 #define i18n_sdl2_WINDOW_HEIGHT_TOO_SMALL_MINIMUM_IS_P0D 61
+#define i18n_sdl2_RUN_BATCH_MANIFEST 62
+#define i18n_sdl2_SET_NUMBER_OF_BATCH_WORKERS 63
+#define i18n_sdl2_INVALID_LINE_P0D_IN_BATCH_MANIFEST_P1S 64
+#define i18n_sdl2_FORK_SESSIONS_ON_REQUEST_FROM_STDIN 65
+#define i18n_sdl2_RUN_SOUND_BENCHMARK 66
+#define i18n_sdl2_WRITE_COUNTERS_REPORT_TO_FILE 67
+#define i18n_sdl2_ZYGOTE_MODE_CANNOT_WRITE_TRANSCRIPT_TO_P0S 68
 
 extern z_ucs fizmo_sdl2_module_name[];
 